@@ -25,7 +25,9 @@ const float PI = 3.14159265359;
 // technique somewhere later in the normal mapping tutorial.
 vec3 getNormalFromMap()
 {
-    vec3 tangentNormal = texture(normalMap, TexCoords).xyz * 2.0 - 1.0;
+    // normal maps are cooked to two channel BC5, z is rebuilt from x/y
+    vec2 tangentXY = texture(normalMap, TexCoords).xy * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(tangentXY, sqrt(max(1.0 - dot(tangentXY, tangentXY), 0.0)));
 
     vec3 Q1  = dFdx(WorldPos);
     vec3 Q2  = dFdy(WorldPos);
@@ -1,15 +1,20 @@
 #version 330 core
 
+// packed mesh layout, see learnopengl/packed_vertex.h
 layout(location = 0) in vec3 pos;
-layout(location = 1) in vec3 norm;
+layout(location = 1) in vec2 normOct;
 layout(location = 2) in vec2 tex;
-layout(location = 3) in vec3 tangent;
-layout(location = 4) in vec3 bitangent;
-layout(location = 5) in ivec4 boneIds; 
-layout(location = 6) in vec4 weights;
+layout(location = 3) in vec4 tangentOct;    // xy octahedral tangent, z bitangent sign
 
-uniform mat4 projection;
-uniform mat4 view;
+// per-frame camera, see FrameUniforms
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;    // xyz
+    vec4 time;              // x seconds, y delta
+};
 uniform mat4 model;
 
 out vec2 TexCoords;
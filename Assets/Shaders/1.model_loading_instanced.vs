@@ -0,0 +1,28 @@
+#version 330 core
+
+// packed mesh layout, see learnopengl/packed_vertex.h
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec2 normOct;
+layout(location = 2) in vec2 tex;
+layout(location = 3) in vec4 tangentOct;    // xy octahedral tangent, z bitangent sign
+
+// per-instance, see RenderQueue
+layout(location = 7) in mat4 model;
+
+// per-frame camera, see FrameUniforms
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;    // xyz
+    vec4 time;              // x seconds, y delta
+};
+
+out vec2 TexCoords;
+
+void main()
+{
+    gl_Position =  projection * view * model * vec4(pos,1.0f);
+	TexCoords = tex;
+}
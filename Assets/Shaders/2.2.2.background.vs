@@ -1,8 +1,15 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 projection;
-uniform mat4 view;
+// per-frame camera, see FrameUniforms
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;    // xyz
+    vec4 time;              // x seconds, y delta
+};
 
 out vec3 WorldPos;
 
@@ -17,11 +17,26 @@ uniform samplerCube irradianceMap;
 uniform samplerCube prefilterMap;
 uniform sampler2D brdfLUT;
 
-// lights
-uniform vec3 lightPositions[4];
-uniform vec3 lightColors[4];
-
-uniform vec3 camPos;
+// clustered point and spot lights, see LightClusters
+uniform samplerBuffer lightData;        // 3 texels per light: position + range, color + cos inner angle, direction + cos outer angle
+uniform usamplerBuffer clusterData;     // (first index, count) of two clusters per texel, then the light indices four per texel
+uniform int lightBase;
+uniform int clusterBase;                // -1 when there are no lists this frame
+uniform int indexBase;
+uniform vec2 clusterTileSize;           // in pixels
+uniform vec2 clusterDepth;              // slice = log(view depth) * x + y
+
+const ivec3 CLUSTER_GRID = ivec3(16, 9, 24);
+
+// per-frame camera, see FrameUniforms
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;    // xyz
+    vec4 time;              // x seconds, y delta
+};
 uniform bool useEmissive;
 
 const float PI = 3.14159265359;
@@ -32,7 +47,9 @@ const float PI = 3.14159265359;
 // technique somewhere later in the normal mapping tutorial.
 vec3 getNormalFromMap()
 {
-    vec3 tangentNormal = texture(normalMap, TexCoords).xyz * 2.0 - 1.0;
+    // normal maps are cooked to two channel BC5, z is rebuilt from x/y
+    vec2 tangentXY = texture(normalMap, TexCoords).xy * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(tangentXY, sqrt(max(1.0 - dot(tangentXY, tangentXY), 0.0)));
 
     vec3 Q1  = dFdx(WorldPos);
     vec3 Q2  = dFdy(WorldPos);
@@ -102,7 +119,7 @@ void main()
        
     // input lighting data
     vec3 N = getNormalFromMap();
-    vec3 V = normalize(camPos - WorldPos);
+    vec3 V = normalize(cameraPosition.xyz - WorldPos);
     vec3 R = reflect(-V, N); 
 
     // calculate reflectance at normal incidence; if dia-electric (like plastic) use F0 
@@ -110,16 +127,35 @@ void main()
     vec3 F0 = vec3(0.04); 
     F0 = mix(F0, albedo, metallic);
 
-    // reflectance equation
+    // reflectance equation, over the lights of this fragment's cluster only
     vec3 Lo = vec3(0.0);
-    for(int i = 0; i < 4; ++i) 
+    float viewDepth = -(view * vec4(WorldPos, 1.0)).z;
+    int slice = int(floor(log(max(viewDepth, 1e-4)) * clusterDepth.x + clusterDepth.y));
+    uvec2 lights = uvec2(0u);
+    if (clusterBase >= 0 && slice < CLUSTER_GRID.z)
     {
+        ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterTileSize), CLUSTER_GRID.xy - 1);
+        int cluster = (max(slice, 0) * CLUSTER_GRID.y + tile.y) * CLUSTER_GRID.x + tile.x;
+        uvec4 record = texelFetch(clusterData, clusterBase + cluster / 2);
+        lights = (cluster % 2 == 0) ? record.xy : record.zw;
+    }
+    for(uint k = 0u; k < lights.y; ++k) 
+    {
+        uint index = lights.x + k;
+        int i = lightBase + 3 * int(texelFetch(clusterData, indexBase + int(index / 4u))[index % 4u]);
+        vec4 positionRange = texelFetch(lightData, i);
+        vec4 colorInner = texelFetch(lightData, i + 1);
+        vec4 directionOuter = texelFetch(lightData, i + 2);
+
         // calculate per-light radiance
-        vec3 L = normalize(lightPositions[i] - WorldPos);
+        vec3 L = normalize(positionRange.xyz - WorldPos);
         vec3 H = normalize(V + L);
-        float distance = length(lightPositions[i] - WorldPos);
-        float attenuation = 1.0 / (distance * distance);
-        vec3 radiance = lightColors[i] * attenuation;
+        float distance = length(positionRange.xyz - WorldPos);
+        // inverse square, windowed to reach zero at the light's range, then the spot cone (always 1 for point lights)
+        float window = clamp(1.0 - pow(distance / positionRange.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance * distance + 0.0001);
+        attenuation *= smoothstep(directionOuter.w, colorInner.w, dot(-L, directionOuter.xyz));
+        vec3 radiance = colorInner.rgb * attenuation;
 
         // Cook-Torrance BRDF
         float NDF = DistributionGGX(N, H, roughness);   
@@ -7,8 +7,15 @@ out vec2 TexCoords;
 out vec3 WorldPos;
 out vec3 Normal;
 
-uniform mat4 projection;
-uniform mat4 view;
+// per-frame camera, see FrameUniforms
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;    // xyz
+    vec4 time;              // x seconds, y delta
+};
 uniform mat4 model;
 uniform mat3 normalMatrix;
 
@@ -1,15 +1,22 @@
 #version 330 core
 
+// packed mesh layout, see learnopengl/packed_vertex.h
 layout(location = 0) in vec3 pos;
-layout(location = 1) in vec3 norm;
+layout(location = 1) in vec2 normOct;
 layout(location = 2) in vec2 tex;
-layout(location = 3) in vec3 tangent;
-layout(location = 4) in vec3 bitangent;
-layout(location = 5) in ivec4 boneIds; 
+layout(location = 3) in vec4 tangentOct;    // xy octahedral tangent, z bitangent sign
+layout(location = 5) in ivec4 boneIds;      // 255 = unused
 layout(location = 6) in vec4 weights;
 
-uniform mat4 projection;
-uniform mat4 view;
+// per-frame camera, see FrameUniforms
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;    // xyz
+    vec4 time;              // x seconds, y delta
+};
 uniform mat4 model;
 
 const int MAX_BONES = 100;
@@ -23,7 +30,7 @@ void main()
     vec4 totalPosition = vec4(0.0f);
     for(int i = 0 ; i < MAX_BONE_INFLUENCE ; i++)
     {
-        if(boneIds[i] == -1) 
+        if(boneIds[i] == 255) 
             continue;
         if(boneIds[i] >=MAX_BONES) 
         {
@@ -32,7 +39,6 @@ void main()
         }
         vec4 localPosition = finalBonesMatrices[boneIds[i]] * vec4(pos,1.0f);
         totalPosition += localPosition * weights[i];
-        vec3 localNormal = mat3(finalBonesMatrices[boneIds[i]]) * norm;
    }
 	
     mat4 viewModel = view * model;
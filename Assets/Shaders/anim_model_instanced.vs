@@ -0,0 +1,60 @@
+#version 330 core
+
+// packed mesh layout, see learnopengl/packed_vertex.h
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec2 normOct;
+layout(location = 2) in vec2 tex;
+layout(location = 3) in vec4 tangentOct;    // xy octahedral tangent, z bitangent sign
+layout(location = 5) in ivec4 boneIds;      // 255 = unused
+layout(location = 6) in vec4 weights;
+
+// per-instance, see SkinnedBatch
+layout(location = 7) in mat4 model;
+layout(location = 11) in int boneOffset;
+
+// per-frame camera, see FrameUniforms
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;    // xyz
+    vec4 time;              // x seconds, y delta
+};
+
+const int MAX_BONE_INFLUENCE = 4;
+// bone palettes of every instance, 4 texels (columns) per matrix
+uniform samplerBuffer bonePalette;
+uniform int boneCount;
+
+out vec2 TexCoords;
+
+mat4 fetchBone(int bone)
+{
+    int base = (boneOffset + bone) * 4;
+    return mat4(texelFetch(bonePalette, base),
+                texelFetch(bonePalette, base + 1),
+                texelFetch(bonePalette, base + 2),
+                texelFetch(bonePalette, base + 3));
+}
+
+void main()
+{
+    vec4 totalPosition = vec4(0.0f);
+    for(int i = 0 ; i < MAX_BONE_INFLUENCE ; i++)
+    {
+        if(boneIds[i] == 255) 
+            continue;
+        if(boneIds[i] >= boneCount) 
+        {
+            totalPosition = vec4(pos,1.0f);
+            break;
+        }
+        vec4 localPosition = fetchBone(boneIds[i]) * vec4(pos,1.0f);
+        totalPosition += localPosition * weights[i];
+   }
+	
+    mat4 viewModel = view * model;
+    gl_Position =  projection * viewModel * totalPosition;
+	TexCoords = tex;
+}
@@ -3,9 +3,11 @@ layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>
 out vec2 TexCoords;
 
 uniform mat4 projection;
+// pixel position of the string's baseline, vertices are laid out from it
+uniform vec2 origin;
 
 void main()
 {
-    gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
+    gl_Position = projection * vec4(vertex.xy + origin, 0.0, 1.0);
     TexCoords = vertex.zw;
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 color;
+
+uniform sampler2D text;
+uniform vec4 textColor;
+
+// FreeType SDF glyphs: the outline sits at 0.5, inside is above it. the edge is
+// smoothed over about one screen pixel whatever size the glyph is drawn at
+void main()
+{    
+    float distance = texture(text, TexCoords).r;
+    float width = max(fwidth(distance) * 0.7, 1e-4);
+    float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+    color = vec4(textColor.rgb, textColor.a * alpha);
+}
@@ -14,7 +14,15 @@ uniform sampler2D texture_metallic1;
 uniform sampler2D texture_roughness1;
 
 uniform vec3 lightPosition;
-uniform vec3 viewPosition;
+// per-frame camera, see FrameUniforms
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;    // xyz
+    vec4 time;              // x seconds, y delta
+};
 
 uniform vec3 lightPositions[4];
 uniform vec3 lightColors[4];
@@ -75,7 +83,7 @@ void main()
 
     vec3 Lo = vec3(0.0);
     vec3 N = fs_in.Normal;
-    vec3 V = normalize(viewPosition - fs_in.FragPos);
+    vec3 V = normalize(cameraPosition.xyz - fs_in.FragPos);
 
     // start light
 
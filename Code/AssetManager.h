@@ -0,0 +1,171 @@
+#pragma once
+
+#include <learnopengl/model.h>
+#include <learnopengl/model_animation.h>
+#include <learnopengl/animation.h>
+
+#include "JobSystem.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Ref-counted handle to a shared asset, the asset is unloaded when the last handle goes away
+template<class T>
+using AssetHandle = std::shared_ptr<T>;
+
+// Loads each model/clip once per canonical path and hands out shared handles to it.
+// The manager itself only keeps weak references, so unused assets are freed right away.
+// Safe to call from JobSystem workers, GL uploads and deletes are then deferred to the main thread.
+class AssetManager
+{
+public:
+	static AssetHandle<Model_Static> LoadModelStatic(const std::string& path)
+	{
+		return Load(s_staticModels, Canonical(path), [&](Model_Static* model) { model->Parse(path); },
+			[](Model_Static* model) { model->Upload(); return ModelBytes(model->meshes); });
+	}
+
+	static AssetHandle<Model_Bone> LoadModelBone(const std::string& path)
+	{
+		return Load(s_boneModels, Canonical(path), [&](Model_Bone* model) { model->Parse(path); },
+			[](Model_Bone* model) { model->Upload(); return ModelBytes(model->meshes); });
+	}
+
+	// clips are bound to the bone map of the model they were read for, so the key includes the model
+	// and the handle keeps that model alive. The model must be parsed already
+	static AssetHandle<Animation> LoadAnimation(const std::string& path, const AssetHandle<Model_Bone>& model)
+	{
+		std::string key = Canonical(path) + "|" + std::to_string((uintptr_t)model.get());
+
+		return Load(s_animations, key, [&](Animation* animation) { animation->Load(path, model.get()); },
+			[](Animation* animation) { return animation->GetMemoryBytes(); }, model);
+	}
+
+	// prints every asset still resident and the memory it holds
+	static void Report()
+	{
+		std::lock_guard<std::recursive_mutex> lock(s_mutex);
+		size_t count = 0;
+		size_t total = 0;
+
+		std::cout << "\n[AssetManager] resident assets" << std::endl;
+		ReportEntries(s_staticModels, "Model_Static", count, total);
+		ReportEntries(s_boneModels, "Model_Bone", count, total);
+		ReportEntries(s_animations, "Animation", count, total);
+		std::cout << "[AssetManager] " << count << " assets, " << total / 1024 << " KB" << std::endl;
+		std::cout << "[AssetManager] vertex buffers uploaded: " << Mesh::s_packedVertexBytes / 1024 << " KB packed ("
+			<< Mesh::s_floatVertexBytes / 1024 << " KB as float vertices)" << std::endl;
+		std::cout << "[AssetManager] materials: " << MaterialLibrary::GetCount() << std::endl;
+
+		TextureCache::Report();
+	}
+
+private:
+	template<class T>
+	struct Entry
+	{
+		std::weak_ptr<T> asset;
+		std::shared_future<void> parsed;
+		size_t bytes = 0;
+	};
+
+	template<class T>
+	using Registry = std::unordered_map<std::string, Entry<T>>;
+
+	// Parse runs on the calling thread (a loader job or main), Upload goes through the GLUploadQueue.
+	// A second request for an asset still being parsed waits for it instead of loading it again;
+	// parsing never sits in the job queue, so the wait cannot starve the pool.
+	// dependency is held by the new asset until it is unloaded
+	template<class T, class Parse, class Upload>
+	static AssetHandle<T> Load(Registry<T>& registry, const std::string& key, Parse parse, Upload upload,
+		std::shared_ptr<void> dependency = nullptr)
+	{
+		std::unique_lock<std::recursive_mutex> lock(s_mutex);
+
+		auto it = registry.find(key);
+		if (it != registry.end())
+		{
+			if (AssetHandle<T> existing = it->second.asset.lock())
+			{
+				std::shared_future<void> parsed = it->second.parsed;
+				lock.unlock();
+				parsed.wait();
+				return existing;
+			}
+		}
+
+		// the last handle can go away on a loader job, the delete frees GL buffers and textures so it runs on
+		// the main thread like the upload did. dependency stays alive until then
+		T* raw = new T();
+		AssetHandle<T> handle(raw, [&registry, key, dependency](T* asset)
+		{
+			{
+				std::lock_guard<std::recursive_mutex> lock(s_mutex);
+				std::cout << "[AssetManager] unload " << key << std::endl;
+				auto it = registry.find(key);
+				if (it != registry.end() && it->second.asset.expired())
+					registry.erase(it);
+			}
+			GLUploadQueue::Push([asset, dependency]() { delete asset; });
+		});
+
+		std::promise<void> parsed;
+		Entry<T>& entry = registry[key];
+		entry.asset = handle;
+		entry.parsed = parsed.get_future().share();
+		lock.unlock();
+
+		parse(raw);
+		parsed.set_value();
+
+		GLUploadQueue::Push([&registry, key, handle, upload]()
+		{
+			size_t bytes = upload(handle.get());
+			std::lock_guard<std::recursive_mutex> lock(s_mutex);
+			registry[key].bytes = bytes;
+		});
+		return handle;
+	}
+
+	template<class T>
+	static void ReportEntries(const Registry<T>& registry, const char* type, size_t& count, size_t& total)
+	{
+		for (auto& [key, entry] : registry)
+		{
+			long refs = entry.asset.use_count();
+			if (refs == 0)
+				continue;
+
+			std::cout << "  " << type << " " << key << " | refs: " << refs << " | " << entry.bytes / 1024 << " KB" << std::endl;
+			count++;
+			total += entry.bytes;
+		}
+	}
+
+	static std::string Canonical(const std::string& path)
+	{
+		std::error_code error;
+		std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+		return error ? path : canonical.generic_string();
+	}
+
+	// vertex/index data, textures are shared and counted by the TextureCache
+	static size_t ModelBytes(const vector<Mesh>& meshes)
+	{
+		size_t bytes = 0;
+		for (const Mesh& mesh : meshes)
+			bytes += mesh.GetMemoryBytes();
+		return bytes;
+	}
+
+	inline static Registry<Model_Static> s_staticModels;
+	inline static Registry<Model_Bone> s_boneModels;
+	inline static Registry<Animation> s_animations;
+	inline static std::recursive_mutex s_mutex;
+};
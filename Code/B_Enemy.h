@@ -16,25 +16,30 @@ namespace Doozy {
 	class Doozy {
 		public:
 
-			Animation* idleAnimation;
-			Animation* walkAnimation;
-			Animation* runAnimation;
-			Animation* punchAnimation;
-			Animation* KnockAnimation;
-			Model_Bone m_model;
+			AssetHandle<Animation> idleAnimation;
+			AssetHandle<Animation> walkAnimation;
+			AssetHandle<Animation> runAnimation;
+			AssetHandle<Animation> punchAnimation;
+			AssetHandle<Animation> KnockAnimation;
+			AssetHandle<Model_Bone> m_model;
 
-			Model_Static* Bullet_Model;
+			AssetHandle<Model_Static> Bullet_Model;
 
+			// same order as Steve: model first, then its clips in parallel
 			Doozy()
-				: m_model("Assets/Models/mixamo/doozy/doozy.dae")
 			{
-				idleAnimation = new Animation("Assets/Models/mixamo/doozy/Fight Idle.dae", &m_model);
-				walkAnimation = new Animation("Assets/Models/mixamo/doozy/Fight Idle.dae", &m_model);
-				runAnimation = new Animation("Assets/Models/mixamo/doozy/Run.dae", &m_model);
-				punchAnimation = new Animation("Assets/Models/mixamo/doozy/Fight Idle.dae", &m_model);
-				KnockAnimation = new Animation("Assets/Models/mixamo/doozy/Slipping.dae", &m_model);
-
-				Bullet_Model = new Model_Static("Assets/Models/Bullets/Bullets.obj");
+				JobSystem::Submit([this]() {
+					m_model = AssetManager::LoadModelBone("Assets/Models/mixamo/doozy/doozy.dae");
+
+					// idle, walk and punch share one clip, the manager reads it once
+					JobSystem::Submit([this]() { idleAnimation = AssetManager::LoadAnimation("Assets/Models/mixamo/doozy/Fight Idle.dae", m_model); });
+					JobSystem::Submit([this]() { walkAnimation = AssetManager::LoadAnimation("Assets/Models/mixamo/doozy/Fight Idle.dae", m_model); });
+					JobSystem::Submit([this]() { runAnimation = AssetManager::LoadAnimation("Assets/Models/mixamo/doozy/Run.dae", m_model); });
+					JobSystem::Submit([this]() { punchAnimation = AssetManager::LoadAnimation("Assets/Models/mixamo/doozy/Fight Idle.dae", m_model); });
+					JobSystem::Submit([this]() { KnockAnimation = AssetManager::LoadAnimation("Assets/Models/mixamo/doozy/Slipping.dae", m_model); });
+				});
+
+				JobSystem::Submit([this]() { Bullet_Model = AssetManager::LoadModelStatic("Assets/Models/Bullets/Bullets.obj"); });
 			}
 
 	}*Data_;
@@ -64,7 +69,6 @@ public:
 
 	Enemy();   
 	void Update();
-	void Render(Shader& shader);
 
 	GameObj* Gun_OBJ;
 	Collider_Capsule* mCollider_Capsule;
@@ -106,7 +110,8 @@ private:
 	float blendAmount = 0.0f;
 	float blendRate = 0.055f;
 
-	Model_Bone* m_model;
+	AssetHandle<Model_Bone> m_model;
+	Lod::Selection m_lod;
 	std::unique_ptr<Animator> m_animator;
 
 	Animation* idleAnimation;
@@ -180,7 +185,7 @@ private:
 			BulletOBJ->Transform.wPosition = GameObject->Transform.wPosition;
 
 			BulletOBJ->Transform.wRotation = GameObject->Transform.wRotation;
-			Bullet* newBull = BulletOBJ->AddComponent(new Bullet(Doozy::Data_->Bullet_Model));
+			Bullet* newBull = BulletOBJ->AddComponent(new Bullet(Doozy::Data_->Bullet_Model.get()));
 			newBull->Team = Bullet::Enemy;
 			newBull->Speed *= 0.5f;
 		}
@@ -195,17 +200,13 @@ private:
 	void Render(Renderer& renderer)
 	{
 
-		Shader& shader = renderer.m_animShader;
-		shader.use();
-
-		vector<glm::mat4> transforms = m_animator->GetFinalBoneMatrices();
-		for (int i = 0; i < transforms.size(); ++i)
-			shader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
-
+		renderer.SubmitSkinned(m_model.get(), BODY->Transform.modelMatrix, m_animator->GetFinalBoneMatrices(), m_lod);
 
-		shader.setMat4("model", BODY->Transform.modelMatrix);
-		m_model->Draw(shader); 
+	}
 
+	bool GetWorldBounds(glm::vec3& center, glm::vec3& extents)
+	{
+		return ModelWorldBounds(m_model.get(), BODY->Transform.modelMatrix, center, extents, SkinnedBoundsPadding);
 	}
 
 
@@ -261,12 +262,12 @@ private:
 
  
 Enemy::Enemy()
-	: m_model(&Doozy::Data_->m_model)
-	, idleAnimation(Doozy::Data_->idleAnimation)
-	, walkAnimation(Doozy::Data_->walkAnimation)
-	, runAnimation(Doozy::Data_->runAnimation)
-	, punchAnimation(Doozy::Data_->punchAnimation)
-	, KnockAnimation(Doozy::Data_->KnockAnimation)
+	: m_model(Doozy::Data_->m_model)
+	, idleAnimation(Doozy::Data_->idleAnimation.get())
+	, walkAnimation(Doozy::Data_->walkAnimation.get())
+	, runAnimation(Doozy::Data_->runAnimation.get())
+	, punchAnimation(Doozy::Data_->punchAnimation.get())
+	, KnockAnimation(Doozy::Data_->KnockAnimation.get())
 {
 	m_animator = std::make_unique<Animator>(walkAnimation);
 }
@@ -3,44 +3,65 @@
 #include "BanKEngine.h"
 #include "Input.h"
 #include "Renderer.h"
+#include "AssetManager.h"
+#include "JobSystem.h"
 
 #include <learnopengl/shader.h>
 #include <learnopengl/animator.h>
 #include <learnopengl/model_animation.h>
+#include <learnopengl/frustum.h>
 
 
+// skinned bounds come from the bind pose, animation reaches a bit past them
+const float SkinnedBoundsPadding = 1.3f;
+
+// world box of a model's object space bounds under modelMatrix, false until the model is uploaded
+template <typename ModelT>
+bool ModelWorldBounds(ModelT* model, const glm::mat4& modelMatrix, glm::vec3& center, glm::vec3& extents, float padding = 1.0f)
+{
+	if (!model || !model->IsUploaded())
+		return false;
+	transformAABB(modelMatrix, model->boundsMin, model->boundsMax, center, extents);
+	extents *= padding;
+	return true;
+}
 
 namespace Steve {
 	class Steve {
 	public:
 
-		Animation* idleAnimation;
-		Animation* idleAnimation_NOGUN;
-		Animation* walkAnimation;
-		Animation* runAnimation;
-		Animation* runAnimation_NOGUN;
-		Animation* DeadAnimation;
-		Animation* kickAnimation;
-		Animation* HitAnimation;
-		Model_Bone m_model;
-
-		Model_Static* Bullet_Model;
-		Model_Static* Gun_Model;
-
+		AssetHandle<Animation> idleAnimation;
+		AssetHandle<Animation> idleAnimation_NOGUN;
+		AssetHandle<Animation> walkAnimation;
+		AssetHandle<Animation> runAnimation;
+		AssetHandle<Animation> runAnimation_NOGUN;
+		AssetHandle<Animation> DeadAnimation;
+		AssetHandle<Animation> kickAnimation;
+		AssetHandle<Animation> HitAnimation;
+		AssetHandle<Model_Bone> m_model;
+
+		AssetHandle<Model_Static> Bullet_Model;
+		AssetHandle<Model_Static> Gun_Model;
+
+		// the model is parsed first since every clip registers its bones on it,
+		// the clips and props then load in parallel on the JobSystem
 		Steve()
-			: m_model("Assets/Models/mixamo/steve.dae")
 		{
-			idleAnimation = new Animation("Assets/Models/mixamo/Rifle Aiming Idle.dae", &m_model);
-			idleAnimation_NOGUN = new Animation("Assets/Models/mixamo/idle.dae", &m_model);
-			walkAnimation = new Animation("Assets/Models/mixamo/walk.dae", &m_model);
-			runAnimation = new Animation("Assets/Models/mixamo/Rifle Run.dae", &m_model);
-			runAnimation_NOGUN = new Animation("Assets/Models/mixamo/Run.dae", &m_model);
-			DeadAnimation = new Animation("Assets/Models/mixamo/Dying.dae", &m_model);
-			kickAnimation = new Animation("Assets/Models/mixamo/kick.dae", &m_model);
-			HitAnimation = new Animation("Assets/Models/mixamo/Hit Reaction.dae", &m_model);
+			JobSystem::Submit([this]() {
+				m_model = AssetManager::LoadModelBone("Assets/Models/mixamo/steve.dae");
+
+				JobSystem::Submit([this]() { idleAnimation = AssetManager::LoadAnimation("Assets/Models/mixamo/Rifle Aiming Idle.dae", m_model); });
+				JobSystem::Submit([this]() { idleAnimation_NOGUN = AssetManager::LoadAnimation("Assets/Models/mixamo/idle.dae", m_model); });
+				JobSystem::Submit([this]() { walkAnimation = AssetManager::LoadAnimation("Assets/Models/mixamo/walk.dae", m_model); });
+				JobSystem::Submit([this]() { runAnimation = AssetManager::LoadAnimation("Assets/Models/mixamo/Rifle Run.dae", m_model); });
+				JobSystem::Submit([this]() { runAnimation_NOGUN = AssetManager::LoadAnimation("Assets/Models/mixamo/Run.dae", m_model); });
+				JobSystem::Submit([this]() { DeadAnimation = AssetManager::LoadAnimation("Assets/Models/mixamo/Dying.dae", m_model); });
+				JobSystem::Submit([this]() { kickAnimation = AssetManager::LoadAnimation("Assets/Models/mixamo/kick.dae", m_model); });
+				JobSystem::Submit([this]() { HitAnimation = AssetManager::LoadAnimation("Assets/Models/mixamo/Hit Reaction.dae", m_model); });
+			});
 			 
-			Bullet_Model = new Model_Static("Assets/Models/Bullets/Bullets.obj");
-			Gun_Model = new Model_Static("Assets/Models/AK47/OBJ/ak7finished.obj");
+			JobSystem::Submit([this]() { Bullet_Model = AssetManager::LoadModelStatic("Assets/Models/Bullets/Bullets.obj"); });
+			JobSystem::Submit([this]() { Gun_Model = AssetManager::LoadModelStatic("Assets/Models/AK47/OBJ/ak7finished.obj"); });
 		}
 
 	}*Data_;
@@ -69,14 +90,19 @@ public:
 	float lifespan = 0.64;
 	float Speed = 0.8f;
 	Model_Static* m_model;
-	Collider_Capsule* mCollider_Capsule;
+	Collider_Capsule* mCollider_Capsule = nullptr;
 	int Team = Bullet::Player;
 
-	Bullet(Model_Static* m_model) :m_model(m_model) {
+	// a bullet without collider only flies and renders, see --stress-bullets in Main
+	bool Collides = true;
+
+	Bullet(Model_Static* m_model, bool collides = true) :m_model(m_model), Collides(collides) {
 	}
 
 	void Init() {
 		GameObject->Transform.wScale = glm::vec3(0.16f);
+		if (!Collides)
+			return;
 		mCollider_Capsule = GameObject->AddComponent(new Collider_Capsule);
 		mCollider_Capsule->Radius = 0.5f;
 		mCollider_Capsule->Height = 0.1f;
@@ -92,17 +118,17 @@ public:
 			GameObject->Destroy = true;
 		}
 
-		if (mCollider_Capsule->Event.isCollided) {
+		if (Collides && mCollider_Capsule->Event.isCollided) {
 			//GameObject->Destroy = true; 
 		}
 	}
 
 	void Render(Renderer& renderer) {
+		renderer.SubmitStatic(renderer.m_basicShader, *m_model, GameObject->Transform.modelMatrix);
+	}
 
-		Shader& shader2 = renderer.m_basicShader;
-		shader2.use();
-		shader2.setMat4("model", GameObject->Transform.modelMatrix);
-		m_model->Draw(shader2);
+	bool GetWorldBounds(glm::vec3& center, glm::vec3& extents) {
+		return ModelWorldBounds(m_model, GameObject->Transform.modelMatrix, center, extents);
 	}
 };
 
@@ -135,14 +161,10 @@ public:
 	}
 	void Render(Renderer& renderer)
 	{
-
-		Shader& shader2 = renderer.m_basicShader;
-		shader2.use();
-
-		shader2.setMat4("model", GameObject->Transform.modelMatrix);
-		Steve::Data_->Gun_Model->Draw(shader2);
-
-
+		renderer.SubmitStatic(renderer.m_basicShader, *Steve::Data_->Gun_Model, GameObject->Transform.modelMatrix);
+	}
+	bool GetWorldBounds(glm::vec3& center, glm::vec3& extents) {
+		return ModelWorldBounds(Steve::Data_->Gun_Model.get(), GameObject->Transform.modelMatrix, center, extents);
 	}
 	void Destruct() { GunCount--; }
 };
@@ -177,7 +199,9 @@ public:
 
 	Player();
 	void Update();
+	void LateUpdate();
 	void Render(Renderer& renderer);
+	bool GetWorldBounds(glm::vec3& center, glm::vec3& extents);
 
 	int Health = 3;
 	GameObj* Gun_OBJ;
@@ -242,7 +266,8 @@ private:
 	float blendAmount = 0.0f;
 
 
-	Model_Bone m_model;
+	AssetHandle<Model_Bone> m_model;
+	Lod::Selection m_lod;
 	std::unique_ptr<Animator> m_animator;
 
 	Animation* idleAnimation;
@@ -273,7 +298,7 @@ private:
 				GameObj* BulletOBJ = GameObj::Create();
 				BulletOBJ->Transform.wPosition = getDirectPosition(Gun_Matrix);
 				BulletOBJ->Transform.LookAt(CamLookat->Transform.getWorldPosition());
-				BulletOBJ->AddComponent(new Bullet(Steve::Data_->Bullet_Model));
+				BulletOBJ->AddComponent(new Bullet(Steve::Data_->Bullet_Model.get()));
 
 				CamArea->Transform.wRotation.x -= B_irand(-2,5);
 				CamArea->Transform.wRotation.y += B_irand(-5,5);
@@ -377,7 +402,7 @@ private:
 			GetBull = mCollider_Capsule->Event.Other->GameObject->GetComponent(GetBull);
 			if (GetBull) {
 				if (GetBull->Team == Bullet::Enemy) {
-					m_animator->PlayAnimation(Steve::Data_->HitAnimation, NULL, 0.1, 0.0f, 0.0f); 
+					m_animator->PlayAnimation(Steve::Data_->HitAnimation.get(), NULL, 0.1, 0.0f, 0.0f); 
 					GetBull->GameObject->Destroy = true;
 
 					Health--;
@@ -421,13 +446,13 @@ private:
 			m_animator->PlayAnimation(kickAnimation, NULL, 0.0f, 0.0f, 0.0f);
 
 		if (HasGun) {
-			idleAnimation = Steve::Data_->idleAnimation;
-			runAnimation = Steve::Data_->runAnimation;
+			idleAnimation = Steve::Data_->idleAnimation.get();
+			runAnimation = Steve::Data_->runAnimation.get();
 		}
 		else
 		{
-			idleAnimation = Steve::Data_->idleAnimation_NOGUN;
-			runAnimation = Steve::Data_->runAnimation_NOGUN;
+			idleAnimation = Steve::Data_->idleAnimation_NOGUN.get();
+			runAnimation = Steve::Data_->runAnimation_NOGUN.get();
 		}
 
 		float blendRate = Time.Deltatime * 4;
@@ -549,13 +574,13 @@ private:
 
 Player::Player()
 	: m_model(Steve::Data_->m_model)
-	, idleAnimation(Steve::Data_->idleAnimation)
-	, walkAnimation(Steve::Data_->walkAnimation)
-	, runAnimation(Steve::Data_->runAnimation)
-	, DeadAnimation(Steve::Data_->DeadAnimation)
-	, kickAnimation(Steve::Data_->kickAnimation)
+	, idleAnimation(Steve::Data_->idleAnimation.get())
+	, walkAnimation(Steve::Data_->walkAnimation.get())
+	, runAnimation(Steve::Data_->runAnimation.get())
+	, DeadAnimation(Steve::Data_->DeadAnimation.get())
+	, kickAnimation(Steve::Data_->kickAnimation.get())
 {
-	m_animator = std::make_unique<Animator>(Steve::Data_->idleAnimation_NOGUN);
+	m_animator = std::make_unique<Animator>(Steve::Data_->idleAnimation_NOGUN.get());
 
 	//std::map<std::string, BoneInfo>::iterator it;
 	//auto boneInfoMap = m_animator->m_CurrentAnimation->GetBoneIDMap();
@@ -584,6 +609,33 @@ void Player::Update()
 
 
 int BoneIdx = MixamoBone_RightHand;
+// the gun follows the hand bone; worked out once the transforms are final so bullets spawn from it even when the player is culled
+void Player::LateUpdate()
+{
+	if (HasGun) {
+		glm::mat4 mm_Parent = BODY->Transform.modelMatrix;
+		glm::mat4 mm_Child = Gun_OBJ->Transform.modelMatrix;
+		glm::mat4 T_asLocal = m_animator->GetFinalBoneMatrices()[BoneIdx];
+		glm::mat4 T_asWorld = mm_Parent * T_asLocal * glm::inverse(mm_Parent);
+		Gun_Matrix = T_asWorld * mm_Child;
+	}
+}
+
+bool Player::GetWorldBounds(glm::vec3& center, glm::vec3& extents)
+{
+	if (!ModelWorldBounds(m_model.get(), BODY->Transform.modelMatrix, center, extents, SkinnedBoundsPadding))
+		return false;
+
+	glm::vec3 gunCenter, gunExtents;
+	if (HasGun && ModelWorldBounds(Steve::Data_->Gun_Model.get(), Gun_Matrix, gunCenter, gunExtents)) {
+		glm::vec3 Min = glm::min(center - extents, gunCenter - gunExtents);
+		glm::vec3 Max = glm::max(center + extents, gunCenter + gunExtents);
+		center = (Min + Max) * 0.5f;
+		extents = (Max - Min) * 0.5f;
+	}
+	return true;
+}
+
 void Player::Render(Renderer& renderer)
 {
 
@@ -594,31 +646,14 @@ void Player::Render(Renderer& renderer)
 	//T pose in this case, will stay there as reference point
 	//and will not be moved 
 
-	Shader& shader = renderer.m_animShader;
-	shader.use();
-
-	vector<glm::mat4> transforms = m_animator->GetFinalBoneMatrices();
-	for (int i = 0; i < transforms.size(); ++i)
-		shader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
-
-	shader.setMat4("model", BODY->Transform.modelMatrix);
-	m_model.Draw(shader);
+	const vector<glm::mat4>& transforms = m_animator->GetFinalBoneMatrices();
+	renderer.SubmitSkinned(m_model.get(), BODY->Transform.modelMatrix, transforms, m_lod);
 
 
 
 
 	if (HasGun) {
-		Shader& shader2 = renderer.m_basicShader;
-		shader2.use();
-
-		glm::mat4 mm_Parent = BODY->Transform.modelMatrix;
-		glm::mat4 mm_Child = Gun_OBJ->Transform.modelMatrix;
-		glm::mat4 T_asLocal = transforms[BoneIdx];
-		glm::mat4 T_asWorld = mm_Parent * T_asLocal * glm::inverse(mm_Parent);
-		Gun_Matrix = T_asWorld * mm_Child;
-
-		shader2.setMat4("model", Gun_Matrix);
-		Steve::Data_->Gun_Model->Draw(shader2);
+		renderer.SubmitStatic(renderer.m_basicShader, *Steve::Data_->Gun_Model, Gun_Matrix);
 	}
 
 }
@@ -74,6 +74,10 @@ namespace BanKEngine {
 			pInst->LateUpdate();
 		} 
 
+		for (GameObj* pInst : sGameObjs) {
+			pInst->UpdateBounds();
+		}
+
 
 		B_ColliderShape::Update();
 
@@ -1,21 +1,62 @@
 #include "FontSystem.h"
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <iterator>
 #include "Application.h"
+#include "StreamBuffer.h"
+
+namespace
+{
+    const uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+    // next codepoint of a UTF-8 string, a malformed sequence decodes to U+FFFD
+    uint32_t NextCodepoint(const std::string& text, size_t& i)
+    {
+        unsigned char lead = static_cast<unsigned char>(text[i++]);
+        if (lead < 0x80)
+            return lead;
+
+        int extra = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : -1;
+        if (extra < 0 || lead > 0xF4)
+            return REPLACEMENT_CHARACTER;
+
+        uint32_t codepoint = lead & (0x3F >> extra);
+        for (int k = 0; k < extra; k++)
+        {
+            if (i >= text.size() || (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80)
+                return REPLACEMENT_CHARACTER;
+            codepoint = (codepoint << 6) | (static_cast<unsigned char>(text[i++]) & 0x3F);
+        }
+        return codepoint;
+    }
+}
 
 OpenGLFontSystem::OpenGLFontSystem()
     : m_shader("Assets/Shaders/font.vert", "Assets/Shaders/font.frag")
+    , m_sdfShader("Assets/Shaders/font.vert", "Assets/Shaders/font_sdf.frag")
 {
+    // the quads live in the StreamBuffer, RenderText points attribute 0 at each string's range
     glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
     glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
+    // All functions return a value different than 0 whenever an error occurred
+    if (FT_Init_FreeType(&m_freeType))
+    {
+        std::cout << "Could not init FreeType Library" << std::endl;
+        m_freeType = nullptr;
+    }
+    else
+    {
+        // the default spread of 2 is too thin to scale glyphs up
+        FT_Int spread = SDF_SPREAD;
+        FT_Property_Set(m_freeType, "sdf", "spread", &spread);
+        FT_Property_Set(m_freeType, "bsdf", "spread", &spread);
+    }
+
     s_defaultFont = std::make_unique<Font>("Assets/Fonts/RobotoMono-Regular.ttf");
     LoadFont(*s_defaultFont);
 
@@ -24,84 +65,307 @@ OpenGLFontSystem::OpenGLFontSystem()
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
+OpenGLFontSystem::~OpenGLFontSystem()
+{
+    for (auto& [name, font] : m_fontMap)
+        font->DeleteTextures();
+    if (s_defaultFont)
+        s_defaultFont->DeleteTextures();
+    s_defaultFont.reset();
+
+    // also closes the faces the SDF glyphs were still loaded from
+    if (m_freeType)
+        FT_Done_FreeType(m_freeType);
+    glDeleteVertexArrays(1, &VAO);
+}
+
 void OpenGLFontSystem::LoadFont(Font& font)
 {
-    FT_Library ft;
-    // All functions return a value different than 0 whenever an error occurred
-    if (FT_Init_FreeType(&ft))
-    {
-        std::cout << "Could not init FreeType Library" << std::endl;
+    if (!m_freeType)
         return;
-    }
 
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t atlasBytes = 0;
     std::string fontName = font.GetPath();
 
+    if (s_sdf)
+    {
+        // nothing is rendered up front, only the face is opened and the atlas allocated
+        SdfGlyphs& sdf = font.GetSdfGlyphs();
+        if (FT_New_Face(m_freeType, fontName.c_str(), 0, &sdf.Face)) {
+            std::cout << "Failed to load font: " << fontName << std::endl;
+            sdf.Face = nullptr;
+            return;
+        }
+        FT_Set_Pixel_Sizes(sdf.Face, 0, SDF_BASE_SIZE);
+
+        sdf.AtlasSize = glm::ivec2(1024, 256);
+        sdf.ShelfCursor = glm::ivec2(1, 1);
+        std::vector<unsigned char> pixels((size_t)sdf.AtlasSize.x * sdf.AtlasSize.y, 0);
+        glGenTextures(1, &sdf.AtlasTexture);
+        glBindTexture(GL_TEXTURE_2D, sdf.AtlasTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, sdf.AtlasSize.x, sdf.AtlasSize.y, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        std::cout << "[Font] " << fontName << ": SDF at " << SDF_BASE_SIZE << " px, " << pixels.size() / 1024 << " KB atlas, glyphs on first use, "
+            << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms" << std::endl;
+        return;
+    }
+
     for (unsigned int size : Font::DEFAULT_FONT_SIZES)
     {
         GlyphMap glyphMap;
 
         FT_Face face;
-        if (FT_New_Face(ft, fontName.c_str(), 0, &face)) {
+        if (FT_New_Face(m_freeType, fontName.c_str(), 0, &face)) {
             std::cout << "Failed to load font: " << fontName << std::endl;
             return;
         }
-        else {
-            // set size to load glyphs as
-            FT_Set_Pixel_Sizes(face, 0, size);
 
-            // disable byte-alignment restriction
-            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        // set size to load glyphs as
+        FT_Set_Pixel_Sizes(face, 0, size);
 
-            // load first 128 characters of ASCII set
-            for (unsigned char c = 0; c < 128; c++)
+        // load first 128 characters of ASCII set, the bitmaps are kept until the atlas is packed
+        std::vector<std::vector<unsigned char>> bitmaps(GlyphMap::CHARACTER_COUNT);
+        for (int c = 0; c < GlyphMap::CHARACTER_COUNT; c++)
+        {
+            // Load character glyph
+            if (FT_Load_Char(face, c, FT_LOAD_RENDER))
             {
-                // Load character glyph
-                if (FT_Load_Char(face, c, FT_LOAD_RENDER))
-                {
-                    std::cout << "Failed to load Glyph" << std::endl;
-                    continue;
-                }
-                // generate texture
-                unsigned int texture;
-                glGenTextures(1, &texture);
-                glBindTexture(GL_TEXTURE_2D, texture);
-                glTexImage2D(
-                    GL_TEXTURE_2D,
-                    0,
-                    GL_RED,
-                    face->glyph->bitmap.width,
-                    face->glyph->bitmap.rows,
-                    0,
-                    GL_RED,
-                    GL_UNSIGNED_BYTE,
-                    face->glyph->bitmap.buffer
-                );
-                // set texture options
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                // now store character for later use
-                Character character = {
-                    texture,
-                    glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-                    glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-                    static_cast<unsigned int>(face->glyph->advance.x)
-                };
-                glyphMap.insert(std::pair<char, Character>(c, character));
+                std::cout << "Failed to load Glyph" << std::endl;
+                continue;
+            }
+            const FT_Bitmap& bitmap = face->glyph->bitmap;
+            Character& character = glyphMap.Characters[c];
+            character.Size = glm::ivec2(bitmap.width, bitmap.rows);
+            character.Bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+            character.Advance = static_cast<unsigned int>(face->glyph->advance.x);
+            for (unsigned int row = 0; row < bitmap.rows; row++)
+                bitmaps[c].insert(bitmaps[c].end(), bitmap.buffer + row * bitmap.pitch, bitmap.buffer + row * bitmap.pitch + bitmap.width);
+        }
+        FT_Done_Face(face);
 
+        // shelves left to right, a new shelf once the row is full; glyphs keep a texel of padding so linear filtering doesn't bleed
+        const int padding = 1;
+        int atlasWidth = std::max(128, (int)size * 16);
+        std::vector<glm::ivec2> origins(GlyphMap::CHARACTER_COUNT);
+        int shelfX = padding, shelfY = padding, shelfHeight = 0;
+        for (int c = 0; c < GlyphMap::CHARACTER_COUNT; c++)
+        {
+            glm::ivec2 glyphSize = glyphMap.Characters[c].Size;
+            if (shelfX + glyphSize.x + padding > atlasWidth)
+            {
+                shelfX = padding;
+                shelfY += shelfHeight + padding;
+                shelfHeight = 0;
             }
-            glBindTexture(GL_TEXTURE_2D, 0);
+            origins[c] = glm::ivec2(shelfX, shelfY);
+            shelfX += glyphSize.x + padding;
+            shelfHeight = std::max(shelfHeight, glyphSize.y);
+        }
+        int atlasHeight = shelfY + shelfHeight + padding;
+
+        std::vector<unsigned char> pixels((size_t)atlasWidth * atlasHeight, 0);
+        for (int c = 0; c < GlyphMap::CHARACTER_COUNT; c++)
+        {
+            Character& character = glyphMap.Characters[c];
+            for (int row = 0; row < character.Size.y; row++)
+                std::copy_n(&bitmaps[c][(size_t)row * character.Size.x], character.Size.x, &pixels[(size_t)(origins[c].y + row) * atlasWidth + origins[c].x]);
+            character.UVMin = glm::vec2(origins[c]) / glm::vec2(atlasWidth, atlasHeight);
+            character.UVMax = glm::vec2(origins[c] + character.Size) / glm::vec2(atlasWidth, atlasHeight);
         }
 
+        // disable byte-alignment restriction
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glGenTextures(1, &glyphMap.AtlasTexture);
+        glBindTexture(GL_TEXTURE_2D, glyphMap.AtlasTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+        // set texture options
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glyphMap.AtlasSize = glm::ivec2(atlasWidth, atlasHeight);
+        atlasBytes += pixels.size();
+
         font.AddGlypMap(size, glyphMap);
+    }
 
-        FT_Done_Face(face);
+    std::cout << "[Font] " << fontName << ": " << std::size(Font::DEFAULT_FONT_SIZES) << " sizes in " << atlasBytes / 1024 << " KB of atlases, "
+        << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms" << std::endl;
+}
+
+const Character* OpenGLFontSystem::GetSdfGlyph(Font& font, uint32_t codepoint)
+{
+    SdfGlyphs& sdf = font.GetSdfGlyphs();
+    auto it = sdf.Characters.find(codepoint);
+    if (it != sdf.Characters.end())
+        return &it->second;
+    if (!sdf.Face || FT_Load_Char(sdf.Face, codepoint, FT_LOAD_DEFAULT))
+        return nullptr;
+
+    FT_GlyphSlot slot = sdf.Face->glyph;
+    Character character = {};
+    character.Advance = static_cast<unsigned int>(slot->advance.x);
+
+    // glyphs without an outline (space) only advance, FT_Render_Glyph fails on them
+    if (!FT_Render_Glyph(slot, FT_RENDER_MODE_SDF) && slot->bitmap.width > 0 && slot->bitmap.rows > 0)
+    {
+        const FT_Bitmap& bitmap = slot->bitmap;
+        glm::ivec2 size(bitmap.width, bitmap.rows);
+
+        // same shelves as the bitmap atlases, the atlas doubles in height when the last shelf is full
+        const int padding = 1;
+        if (sdf.ShelfCursor.x + size.x + padding > sdf.AtlasSize.x)
+        {
+            sdf.ShelfCursor = glm::ivec2(padding, sdf.ShelfCursor.y + sdf.ShelfHeight + padding);
+            sdf.ShelfHeight = 0;
+        }
+        bool fits = true;
+        while (fits && sdf.ShelfCursor.y + size.y + padding > sdf.AtlasSize.y)
+            fits = GrowSdfAtlas(sdf);
+
+        if (fits)
+        {
+            glm::ivec2 origin = sdf.ShelfCursor;
+            glBindTexture(GL_TEXTURE_2D, sdf.AtlasTexture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, bitmap.pitch);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, origin.x, origin.y, size.x, size.y, GL_RED, GL_UNSIGNED_BYTE, bitmap.buffer);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            sdf.ShelfCursor.x += size.x + padding;
+            sdf.ShelfHeight = std::max(sdf.ShelfHeight, size.y);
+            sdf.Origins[codepoint] = origin;
+
+            character.Size = size;
+            character.Bearing = glm::ivec2(slot->bitmap_left, slot->bitmap_top);
+            character.UVMin = glm::vec2(origin) / glm::vec2(sdf.AtlasSize);
+            character.UVMax = glm::vec2(origin + size) / glm::vec2(sdf.AtlasSize);
+        }
+    }
+
+    return &(sdf.Characters[codepoint] = character);
+}
+
+bool OpenGLFontSystem::GrowSdfAtlas(SdfGlyphs& sdf)
+{
+    if (sdf.AtlasSize.y * 2 > SDF_MAX_ATLAS)
+    {
+        std::cout << "[Font] SDF atlas is full at " << sdf.AtlasSize.x << "x" << sdf.AtlasSize.y << ", glyph dropped" << std::endl;
+        return false;
+    }
+
+    // same width, so the old rows read back as the top of the new texture
+    glm::ivec2 size(sdf.AtlasSize.x, sdf.AtlasSize.y * 2);
+    std::vector<unsigned char> pixels((size_t)size.x * size.y, 0);
+    glBindTexture(GL_TEXTURE_2D, sdf.AtlasTexture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, size.x, size.y, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    sdf.AtlasSize = size;
+
+    // UVs are normalized, every glyph and every cached layout moved
+    for (const auto& [codepoint, origin] : sdf.Origins)
+    {
+        Character& character = sdf.Characters[codepoint];
+        character.UVMin = glm::vec2(origin) / glm::vec2(size);
+        character.UVMax = glm::vec2(origin + character.Size) / glm::vec2(size);
     }
+    m_layoutCache.clear();
 
-    FT_Done_FreeType(ft);
+    std::cout << "[Font] SDF atlas grown to " << size.x << "x" << size.y << " (" << pixels.size() / 1024 << " KB), "
+        << sdf.Characters.size() << " glyphs" << std::endl;
+    return true;
 }
 
+const OpenGLFontSystem::TextLayout& OpenGLFontSystem::GetLayout(const std::string& text, Font& font, float size)
+{
+    std::string key = font.GetPath();
+    key += '\0';
+    key += std::to_string(size);
+    key += '\0';
+    key += text;
+
+    auto it = m_layoutCache.find(key);
+    if (it != m_layoutCache.end())
+        return it->second;
+
+    // SDF glyphs new to this string, and the '?' standing in for the ones that fail, are rendered before anything
+    // is laid out: growing the atlas clears the cache the layout below is built in
+    std::vector<uint32_t> codepoints;
+    for (size_t i = 0; i < text.size();)
+        codepoints.push_back(NextCodepoint(text, i));
+    if (s_sdf)
+    {
+        GetSdfGlyph(font, '?');
+        for (uint32_t codepoint : codepoints)
+            GetSdfGlyph(font, codepoint);
+    }
+
+    if (m_layoutCache.size() >= MAX_CACHED_LAYOUTS)
+        m_layoutCache.clear();
+
+    TextLayout& layout = m_layoutCache[key];
+    // SDF glyphs scale from their base size, bitmap glyphs are drawn 1:1 and snapped to pixels
+    float scale = s_sdf ? size / SDF_BASE_SIZE : 1.0f;
+    float x = 0.0f;
+
+    // iterate through all characters
+    for (uint32_t codepoint : codepoints)
+    {
+        const Character* glyph = nullptr;
+        if (s_sdf)
+        {
+            glyph = GetSdfGlyph(font, codepoint);
+            if (!glyph)
+                glyph = GetSdfGlyph(font, '?');
+        }
+        else
+        {
+            glyph = &font.GetGlyphs(static_cast<unsigned int>(size)).Get(codepoint);
+        }
+        if (!glyph)
+            continue;
+        const Character& ch = *glyph;
+
+        float xpos = x + ch.Bearing.x * scale;
+        float ypos = -(float)(ch.Size.y - ch.Bearing.y) * scale;
+        if (!s_sdf)
+        {
+            xpos = std::floor(xpos);
+            ypos = std::floor(ypos);
+        }
+
+        float w = ch.Size.x * scale;
+        float h = ch.Size.y * scale;
+        // quad of this character, glyphs without pixels only advance
+        if (ch.Size.x > 0 && ch.Size.y > 0)
+        {
+            layout.vertices.insert(layout.vertices.end(), {
+                glm::vec4(xpos,     ypos + h,   ch.UVMin.x, ch.UVMin.y),
+                glm::vec4(xpos,     ypos,       ch.UVMin.x, ch.UVMax.y),
+                glm::vec4(xpos + w, ypos,       ch.UVMax.x, ch.UVMax.y),
+
+                glm::vec4(xpos,     ypos + h,   ch.UVMin.x, ch.UVMin.y),
+                glm::vec4(xpos + w, ypos,       ch.UVMax.x, ch.UVMax.y),
+                glm::vec4(xpos + w, ypos + h,   ch.UVMax.x, ch.UVMin.y)
+            });
+        }
+
+        // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
+        x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
+    }
+    return layout;
+}
 
 void OpenGLFontSystem::RenderText(const std::string& text, const glm::vec2& position, float scale, const glm::vec4& color)
 {
@@ -112,66 +376,36 @@ void OpenGLFontSystem::RenderText(const std::string& text, const glm::vec2& posi
     if (m_currentFont != nullptr)
         usingFont = m_currentFont;
 
-    if (!usingFont->HasSize(fontSize))
+    // bitmap fonts only have their DEFAULT_FONT_SIZES, SDF fonts draw at any size
+    if (s_sdf ? scale <= 0.0f : !usingFont->HasSize(fontSize))
+        return;
+
+    // the whole string is one range of the StreamBuffer and one draw out of the atlas
+    const TextLayout& layout = GetLayout(text, *usingFont, s_sdf ? scale : (float)fontSize);
+    size_t offset;
+    if (layout.vertices.empty() || !StreamBuffer::Write(layout.vertices.data(), layout.vertices.size() * sizeof(glm::vec4), sizeof(glm::vec4), offset))
         return;
 
     // activate corresponding render state	
-    m_shader.use();
-    m_shader.setVec4("textColor", color);
+    Shader& shader = s_sdf ? m_sdfShader : m_shader;
+    shader.use();
+    shader.setVec4("textColor", color);
 
     glm::vec2 screenSize = Application::Get().GetWindowSize();
 
     glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(screenSize.x), 0.0f, static_cast<float>(screenSize.y));
-    m_shader.setMat4("projection", projection);
+    shader.setMat4("projection", projection);
+    shader.setVec2("origin", glm::vec2(std::floor(position.x), std::floor(screenSize.y - position.y)));
 
     glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, s_sdf ? usingFont->GetSdfGlyphs().AtlasTexture : usingFont->GetGlyphs(fontSize).AtlasTexture);
     glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, StreamBuffer::GetBuffer());
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)offset);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    float x = position.x;
-    float y = screenSize.y - position.y;
-
-    float screenSizePercentage = 1.0f;
-    float realScale = scale * screenSizePercentage / (float)fontSize;
-
-    auto& Characters = usingFont->GetCharacters(fontSize);
-
-    float xOffset = 0;
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)layout.vertices.size());
 
-    // iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
-    {
-        Character ch = Characters[*c];
-
-        float xpos = std::floor(x + ch.Bearing.x * realScale - xOffset);
-        float ypos = std::floor(y - (ch.Size.y - ch.Bearing.y) * realScale);
-
-        float w = ch.Size.x * realScale;
-        float h = ch.Size.y * realScale;
-        // update VBO for each character
-        float vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos,     ypos,       0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 0.0f }
-        };
-
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
-        x += (ch.Advance >> 6) * realScale; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
-    }
     glBindVertexArray(0);
     glBindTexture(GL_TEXTURE_2D, 0);
-}
\ No newline at end of file
+}
@@ -6,21 +6,50 @@
 #include <glm/fwd.hpp>
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_MODULE_H
 
+#include <array>
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 #include <glm/glm.hpp>
 #include <learnopengl/shader.h>
 
 struct Character {
-	unsigned int TextureID; // ID handle of the glyph texture
+	glm::vec2    UVMin;     // corners of the glyph in the atlas of its size
+	glm::vec2    UVMax;
 	glm::ivec2   Size;      // Size of glyph
 	glm::ivec2   Bearing;   // Offset from baseline to left/top of glyph
 	unsigned int Advance;   // Horizontal offset to advance to next glyph
 };
 
-typedef std::map<char, Character> GlyphMap;
+// the ASCII glyphs of one size, shelf packed into a single texture so a whole string draws with one bind
+struct GlyphMap {
+	static const int CHARACTER_COUNT = 128;
+
+	unsigned int AtlasTexture = 0;
+	glm::ivec2 AtlasSize = glm::ivec2(0);
+	std::array<Character, CHARACTER_COUNT> Characters = {};
+
+	// codepoints outside ASCII show as '?'
+	const Character& Get(uint32_t codepoint) const
+	{
+		return Characters[codepoint < CHARACTER_COUNT ? codepoint : '?'];
+	}
+};
+
+// glyphs of any codepoint rendered as signed distance fields on first use, at one base size into one atlas,
+// and drawn at any size from it. the face stays open for the glyphs still to come
+struct SdfGlyphs {
+	FT_Face Face = nullptr;
+	unsigned int AtlasTexture = 0;
+	glm::ivec2 AtlasSize = glm::ivec2(0);
+	glm::ivec2 ShelfCursor = glm::ivec2(0);	// where the next glyph goes on the current shelf
+	int ShelfHeight = 0;
+	std::unordered_map<uint32_t, Character> Characters;
+	std::unordered_map<uint32_t, glm::ivec2> Origins;	// texel position of every glyph, for the UVs when the atlas grows
+};
 
 class Font
 {
@@ -40,7 +69,7 @@ public:
 		return m_glyphs.find(size) != m_glyphs.end();
 	}
 
-	std::map<char, Character>& GetCharacters(unsigned int size)
+	const GlyphMap& GetGlyphs(unsigned int size)
 	{
 		return m_glyphs[size];
 	}
@@ -50,6 +79,21 @@ public:
 		m_glyphs.insert({ size, glyphMap });
 	}
 
+	SdfGlyphs& GetSdfGlyphs()
+	{
+		return m_sdf;
+	}
+
+	// frees the atlas of every size and the SDF atlas, GL thread only. the SDF face is closed with the FreeType library
+	void DeleteTextures()
+	{
+		for (auto& [size, glyphMap] : m_glyphs)
+			glDeleteTextures(1, &glyphMap.AtlasTexture);
+		m_glyphs.clear();
+		glDeleteTextures(1, &m_sdf.AtlasTexture);
+		m_sdf = SdfGlyphs();
+	}
+
     std::string GetPath() const
     {
         return m_path;
@@ -58,6 +102,7 @@ public:
 protected:
     std::string m_path;
 	std::map<unsigned int, GlyphMap> m_glyphs;
+	SdfGlyphs m_sdf;
 };
 
 class FontSystem
@@ -84,22 +129,42 @@ protected:
     friend class Renderer;
 };
 
-typedef std::map<GLchar, Character> FontFace;
-
 class OpenGLFontSystem : public FontSystem
 {
 public:
+    // SDF glyphs generated on first use at SDF_BASE_SIZE, or every DEFAULT_FONT_SIZES bitmap atlas built up front
+    // (only those sizes draw then). set before the font system is created
+    inline static bool s_sdf = true;
+    static const unsigned int SDF_BASE_SIZE = 48;
+    static const int SDF_SPREAD = 6;	// pixels of distance around the outline at the base size
+    static const int SDF_MAX_ATLAS = 4096;
+
     OpenGLFontSystem();
+    ~OpenGLFontSystem();
 
     //virtual int Initialize() override;
     virtual void RenderText(const std::string& text, const glm::vec2& position, float scale, const glm::vec4& color) override;
     virtual void LoadFont(Font& font) override;
 
 private:
-    std::map<GLchar, Character> Characters;
-
-    std::unordered_map<std::string, FontFace> fontFaceMap;
-
-    unsigned int VAO, VBO;
+    // quads of a string laid out from its origin, drawn moved by the "origin" uniform
+    struct TextLayout
+    {
+        std::vector<glm::vec4> vertices;
+    };
+    const TextLayout& GetLayout(const std::string& text, Font& font, float size);
+
+    // the glyph from the SDF atlas, rendered into it first if this is its first use. nullptr when it can't be loaded
+    const Character* GetSdfGlyph(Font& font, uint32_t codepoint);
+    // doubles the atlas height keeping the glyphs already in it
+    bool GrowSdfAtlas(SdfGlyphs& sdf);
+
+    FT_Library m_freeType = nullptr;
+    unsigned int VAO;
+    // layouts by font, size and text, so strings drawn every frame (the HUD) are laid out once.
+    // cleared whenever it grows past MAX_CACHED_LAYOUTS, text that changes every frame would otherwise pile up
+    static const size_t MAX_CACHED_LAYOUTS = 256;
+    std::unordered_map<std::string, TextLayout> m_layoutCache;
     Shader m_shader;
+    Shader m_sdfShader;
 };
\ No newline at end of file
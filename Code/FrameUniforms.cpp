@@ -0,0 +1,34 @@
+#include "FrameUniforms.h"
+
+FrameUniforms::~FrameUniforms()
+{
+	glDeleteBuffers(1, &m_ubo);
+}
+
+void FrameUniforms::Init()
+{
+	glGenBuffers(1, &m_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, m_ubo);
+}
+
+void FrameUniforms::Attach(const Shader& shader) const
+{
+	shader.bindUniformBlock("FrameData", BINDING);
+}
+
+void FrameUniforms::Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float time, float deltaTime)
+{
+	FrameData data;
+	data.view = view;
+	data.projection = projection;
+	data.viewProjection = projection * view;
+	data.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+	data.time = glm::vec4(time, deltaTime, 0.0f, 0.0f);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/shader_m.h>
+
+// std140 mirror of the FrameData uniform block the camera space shaders declare:
+//
+//   layout(std140) uniform FrameData { mat4 view; mat4 projection; mat4 viewProjection; vec4 cameraPosition; vec4 time; };
+struct FrameData
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec4 cameraPosition;	// xyz, w unused
+	glm::vec4 time;	// x seconds since start, y frame delta
+};
+
+// One uniform buffer with the camera of the frame, uploaded once and read by every shader attached to it
+// instead of each of them getting its own view/projection uniforms
+class FrameUniforms
+{
+public:
+	static const GLuint BINDING = 0;
+
+	~FrameUniforms();
+
+	void Init();
+
+	// points the shader's FrameData block at BINDING, again after the program is recompiled
+	void Attach(const Shader& shader) const;
+
+	void Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float time, float deltaTime);
+
+private:
+	unsigned int m_ubo = 0;
+};
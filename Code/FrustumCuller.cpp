@@ -0,0 +1,96 @@
+#include "FrustumCuller.h"
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define FRUSTUM_CULLER_SSE 1
+#endif
+
+void FrustumCuller::Clear()
+{
+	m_count = 0;
+	m_visibleCount = 0;
+	m_centerX.clear();
+	m_centerY.clear();
+	m_centerZ.clear();
+	m_extentX.clear();
+	m_extentY.clear();
+	m_extentZ.clear();
+}
+
+size_t FrustumCuller::Add(const glm::vec3& center, const glm::vec3& extents)
+{
+	m_centerX.push_back(center.x);
+	m_centerY.push_back(center.y);
+	m_centerZ.push_back(center.z);
+	m_extentX.push_back(extents.x);
+	m_extentY.push_back(extents.y);
+	m_extentZ.push_back(extents.z);
+	return m_count++;
+}
+
+void FrustumCuller::Cull(const Frustum& frustum)
+{
+	const Plane* planes[6] = { &frustum.leftFace, &frustum.rightFace, &frustum.nearFace, &frustum.farFace, &frustum.topFace, &frustum.bottomFace };
+
+	// pad to a multiple of four with empty boxes at the origin, their results are never read. The padding is
+	// dropped again at the end so an Add after Cull still lands in slot m_count
+	size_t padded = (m_count + 3) & ~size_t(3);
+	for (std::vector<float>* lane : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ })
+		lane->resize(padded, 0.0f);
+	m_visible.assign(padded, 0);
+
+#ifdef FRUSTUM_CULLER_SSE
+	// a box is outside a plane when its center lies further behind it than the box reaches along the normal
+	__m128 normalX[6], normalY[6], normalZ[6], absX[6], absY[6], absZ[6], distance[6];
+	for (int p = 0; p < 6; p++)
+	{
+		normalX[p] = _mm_set1_ps(planes[p]->normal.x);
+		normalY[p] = _mm_set1_ps(planes[p]->normal.y);
+		normalZ[p] = _mm_set1_ps(planes[p]->normal.z);
+		absX[p] = _mm_set1_ps(std::abs(planes[p]->normal.x));
+		absY[p] = _mm_set1_ps(std::abs(planes[p]->normal.y));
+		absZ[p] = _mm_set1_ps(std::abs(planes[p]->normal.z));
+		distance[p] = _mm_set1_ps(planes[p]->distance);
+	}
+
+	for (size_t i = 0; i < padded; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(&m_centerX[i]), cy = _mm_loadu_ps(&m_centerY[i]), cz = _mm_loadu_ps(&m_centerZ[i]);
+		__m128 ex = _mm_loadu_ps(&m_extentX[i]), ey = _mm_loadu_ps(&m_extentY[i]), ez = _mm_loadu_ps(&m_extentZ[i]);
+
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 signedDistance = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX[p], cx), _mm_mul_ps(normalY[p], cy)), _mm_mul_ps(normalZ[p], cz)), distance[p]);
+			__m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(signedDistance, reach), _mm_setzero_ps()));
+		}
+
+		int mask = _mm_movemask_ps(outside);
+		for (int lane = 0; lane < 4; lane++)
+			m_visible[i + lane] = (mask & (1 << lane)) ? 0 : 1;
+	}
+#else
+	for (size_t i = 0; i < padded; i++)
+	{
+		bool visible = true;
+		for (int p = 0; p < 6 && visible; p++)
+		{
+			const Plane& plane = *planes[p];
+			float signedDistance = plane.normal.x * m_centerX[i] + plane.normal.y * m_centerY[i] + plane.normal.z * m_centerZ[i] - plane.distance;
+			float reach = std::abs(plane.normal.x) * m_extentX[i] + std::abs(plane.normal.y) * m_extentY[i] + std::abs(plane.normal.z) * m_extentZ[i];
+			visible = signedDistance + reach >= 0.0f;
+		}
+		m_visible[i] = visible ? 1 : 0;
+	}
+#endif
+
+	for (std::vector<float>* lane : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ })
+		lane->resize(m_count);
+
+	m_visibleCount = 0;
+	for (size_t i = 0; i < m_count; i++)
+		m_visibleCount += m_visible[i];
+}
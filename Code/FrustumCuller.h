@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <learnopengl/frustum.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Batch frustum test for world space boxes. Boxes are stored as structure of arrays and tested
+// four at a time with SSE against all six planes, so the whole scene is culled in one tight loop
+// before any draw is issued.
+//
+// per frame: Clear, Add every renderable, Cull, then IsVisible while drawing
+class FrustumCuller
+{
+public:
+	void Clear();
+
+	// world space box, returns the slot to query IsVisible with
+	size_t Add(const glm::vec3& center, const glm::vec3& extents);
+
+	void Cull(const Frustum& frustum);
+
+	bool IsVisible(size_t slot) const { return m_visible[slot] != 0; }
+	size_t GetCount() const { return m_count; }
+	size_t GetVisibleCount() const { return m_visibleCount; }
+
+private:
+	std::vector<float> m_centerX, m_centerY, m_centerZ;
+	std::vector<float> m_extentX, m_extentY, m_extentZ;
+	std::vector<uint8_t> m_visible;
+	size_t m_count = 0;
+	size_t m_visibleCount = 0;
+};
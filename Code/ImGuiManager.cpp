@@ -52,6 +52,7 @@ void ImGuiManager::RenderLights(std::vector<Light>& lights)
 	if (ImGui::Button("Add"))
 	{
 		lights.push_back(Light{});
+		lights.back().type = LightType::Point;
 	}
 
 	int toDeleteLight = -1;
@@ -63,6 +64,7 @@ void ImGuiManager::RenderLights(std::vector<Light>& lights)
 
 		ImGui::PushID(i);
 		glm::vec3 tempPos = InputVec3("Pos", lights[i].position);
+		ImGui::InputFloat("Range", &lights[i].range);
 
 		if (ImGui::Button("Delete"))
 		{
@@ -89,6 +89,8 @@ public:
 	virtual void LateUpdate() {}
 	virtual void Render(Renderer& renderer){}
 	virtual void Destruct() {}//// for components with Scene Containers //////////////
+	// world space box around what Render draws, false when it draws nothing (see FrustumCuller)
+	virtual bool GetWorldBounds(glm::vec3& /*center*/, glm::vec3& /*extents*/) { return false; }
 
 };
 
@@ -369,6 +371,28 @@ class Renderer;
 															}
 														}
 
+										/// Bounds ///////////////////
+														// world space box around every component's draw, refreshed after the transforms each frame.
+														// objects without one are never frustum culled
+														bool HasBounds = false;
+														glm::vec3 BoundsCenter = glm::vec3(0.0f);
+														glm::vec3 BoundsExtents = glm::vec3(0.0f);
+														void UpdateBounds() {
+															HasBounds = false;
+															glm::vec3 Min, Max;
+															for (BanKBehavior* Each : MyComponents) {
+																glm::vec3 Center, Extents;
+																if (!Each->GetWorldBounds(Center, Extents)) { continue; }
+																Min = HasBounds ? glm::min(Min, Center - Extents) : Center - Extents;
+																Max = HasBounds ? glm::max(Max, Center + Extents) : Center + Extents;
+																HasBounds = true;
+															}
+															if (HasBounds) {
+																BoundsCenter = (Min + Max) * 0.5f;
+																BoundsExtents = (Max - Min) * 0.5f;
+															}
+														}
+
 
 
 
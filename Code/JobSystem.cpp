@@ -0,0 +1,163 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+std::vector<std::thread> JobSystem::s_workers;
+std::deque<std::function<void()>> JobSystem::s_jobs;
+std::mutex JobSystem::s_mutex;
+std::condition_variable JobSystem::s_wake;
+std::atomic<int> JobSystem::s_pending = 0;
+bool JobSystem::s_stop = false;
+
+std::deque<std::function<void()>> GLUploadQueue::s_tasks;
+std::mutex GLUploadQueue::s_mutex;
+std::thread::id GLUploadQueue::s_mainThread;
+
+void JobSystem::Init(unsigned int workerCount)
+{
+	s_stop = false;
+	for (unsigned int i = 0; i < workerCount; i++)
+		s_workers.emplace_back(WorkerLoop);
+}
+
+void JobSystem::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		s_stop = true;
+	}
+	s_wake.notify_all();
+
+	for (std::thread& worker : s_workers)
+		worker.join();
+	s_workers.clear();
+}
+
+void JobSystem::Submit(std::function<void()> job)
+{
+	if (s_workers.empty())
+	{
+		job();
+		return;
+	}
+
+	s_pending++;
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		s_jobs.push_back(std::move(job));
+	}
+	s_wake.notify_one();
+}
+
+void JobSystem::ParallelFor(int count, const std::function<void(int)>& body)
+{
+	if (count <= 0)
+		return;
+
+	struct Shared
+	{
+		std::atomic<int> next = 0;
+		std::atomic<int> done = 0;
+	};
+	auto shared = std::make_shared<Shared>();
+
+	// a helper picked up after everything ran finds no index left and never touches body
+	auto run = [shared, &body, count]()
+	{
+		for (int i = shared->next++; i < count; i = shared->next++)
+		{
+			body(i);
+			shared->done++;
+		}
+	};
+
+	int helpers = std::min((int)s_workers.size(), count - 1);
+	for (int i = 0; i < helpers; i++)
+		Submit(run);
+	run();
+
+	while (shared->done < count)
+		std::this_thread::yield();
+}
+
+bool JobSystem::IsIdle()
+{
+	return s_pending == 0;
+}
+
+void JobSystem::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(s_mutex);
+			s_wake.wait(lock, [] { return s_stop || !s_jobs.empty(); });
+			if (s_stop && s_jobs.empty())
+				return;
+
+			job = std::move(s_jobs.front());
+			s_jobs.pop_front();
+		}
+
+		job();
+		// destroy the captures before the job counts as finished
+		job = nullptr;
+		s_pending--;
+	}
+}
+
+void GLUploadQueue::SetMainThread()
+{
+	s_mainThread = std::this_thread::get_id();
+}
+
+bool GLUploadQueue::IsMainThread()
+{
+	return std::this_thread::get_id() == s_mainThread;
+}
+
+void GLUploadQueue::Push(std::function<void()> task)
+{
+	if (IsMainThread())
+	{
+		task();
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_tasks.push_back(std::move(task));
+}
+
+int GLUploadQueue::Process(double budgetMs)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	int count = 0;
+
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::lock_guard<std::mutex> lock(s_mutex);
+			if (s_tasks.empty())
+				break;
+			task = std::move(s_tasks.front());
+			s_tasks.pop_front();
+		}
+
+		task();
+		count++;
+
+		if (std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() > budgetMs)
+			break;
+	}
+	return count;
+}
+
+bool GLUploadQueue::IsEmpty()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	return s_tasks.empty();
+}
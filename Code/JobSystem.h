@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small worker pool for CPU side loading work (Assimp import, image decode).
+// Initialised with 0 workers every job runs inline on the caller, which is the old serial path.
+class JobSystem
+{
+public:
+	static void Init(unsigned int workerCount);
+	static void Shutdown();
+
+	static void Submit(std::function<void()> job);
+
+	// runs body(0) .. body(count - 1) spread over the workers and returns once all of them ran.
+	// the caller works through the indices too, so it never waits on unrelated jobs queued ahead
+	static void ParallelFor(int count, const std::function<void(int)>& body);
+
+	// no job queued or running
+	static bool IsIdle();
+	static unsigned int GetWorkerCount() { return (unsigned int)s_workers.size(); }
+
+private:
+	static void WorkerLoop();
+
+	static std::vector<std::thread> s_workers;
+	static std::deque<std::function<void()>> s_jobs;
+	static std::mutex s_mutex;
+	static std::condition_variable s_wake;
+	static std::atomic<int> s_pending;
+	static bool s_stop;
+};
+
+// GL work handed back to the main thread by the loaders, drained under a time budget every frame
+class GLUploadQueue
+{
+public:
+	// the thread owning the GL context, call once from main
+	static void SetMainThread();
+	static bool IsMainThread();
+
+	// runs right away when called on the main thread
+	static void Push(std::function<void()> task);
+
+	// runs queued uploads until budgetMs is spent (at least one per call), returns how many ran
+	static int Process(double budgetMs);
+	static bool IsEmpty();
+
+private:
+	static std::deque<std::function<void()>> s_tasks;
+	static std::mutex s_mutex;
+	static std::thread::id s_mainThread;
+};
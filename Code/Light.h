@@ -15,6 +15,13 @@ struct Light
 	LightType type = LightType::None;
 	glm::vec3 position { 0.0f };
 	glm::vec3 color { 1.0f };
+	float intensity = 1.0f;
+	// point and spot lights fade to nothing at range, which bounds the clusters they are assigned to (see LightClusters)
+	float range = 10.0f;
+	// spot lights only, the cone's axis and its inner/outer half angles in degrees
+	glm::vec3 direction { 0.0f, -1.0f, 0.0f };
+	float innerAngle = 20.0f;
+	float outerAngle = 30.0f;
 
 	Light() = default;
 
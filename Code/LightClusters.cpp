@@ -0,0 +1,270 @@
+#include "LightClusters.h"
+#include "JobSystem.h"
+#include "StreamBuffer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define LIGHT_CLUSTERS_SSE 1
+#endif
+
+namespace
+{
+	const int TILES_PER_SLICE = LightClusters::GRID_X * LightClusters::GRID_Y;
+	static_assert(TILES_PER_SLICE % 4 == 0, "a slice must hold whole groups of four clusters");
+	static_assert(LightClusters::CLUSTER_COUNT % 2 == 0, "cluster records are packed two per texel");
+
+	// texels per light in the light data: position + range, color + cos inner angle, direction + cos outer angle
+	const int LIGHT_TEXELS = 3;
+
+	// smallest sphere around a light's reach: the whole range for point lights, the cone for spots
+	glm::vec4 BoundingSphere(const Light& light)
+	{
+		if (light.type != LightType::Spot || light.outerAngle >= 90.0f)
+			return glm::vec4(light.position, light.range);
+
+		float angle = glm::radians(light.outerAngle);
+		glm::vec3 axis = glm::normalize(light.direction);
+		if (angle > glm::radians(45.0f))
+			return glm::vec4(light.position + axis * light.range * std::cos(angle), light.range * std::sin(angle));
+		float reach = light.range / (2.0f * std::cos(angle));
+		return glm::vec4(light.position + axis * reach, reach);
+	}
+}
+
+LightClusters::~LightClusters()
+{
+	glDeleteTextures(1, &m_lightTexture);
+	glDeleteTextures(1, &m_clusterTexture);
+}
+
+void LightClusters::Init()
+{
+	// both look at the whole StreamBuffer like the bone palette, the shader gets each list's texel offset
+	glGenTextures(1, &m_lightTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, m_lightTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, StreamBuffer::GetBuffer());
+	glGenTextures(1, &m_clusterTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, m_clusterTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, StreamBuffer::GetBuffer());
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::BuildClusters(const glm::mat4& projection, float nearPlane, float farPlane)
+{
+	m_projection = projection;
+	m_near = nearPlane;
+	m_far = farPlane;
+	for (std::vector<float>* bounds : { &m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY, &m_maxZ })
+		bounds->resize(CLUSTER_COUNT);
+	m_slots.resize((size_t)CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+	m_counts.resize(CLUSTER_COUNT);
+
+	// the ray through every tile corner, as the view space point on the near plane
+	glm::mat4 inverse = glm::inverse(projection);
+	std::vector<glm::vec3> rays((GRID_X + 1) * (GRID_Y + 1));
+	for (int y = 0; y <= GRID_Y; y++)
+	{
+		for (int x = 0; x <= GRID_X; x++)
+		{
+			glm::vec4 corner = inverse * glm::vec4(2.0f * x / GRID_X - 1.0f, 2.0f * y / GRID_Y - 1.0f, -1.0f, 1.0f);
+			glm::vec3 point = glm::vec3(corner) / corner.w;
+			rays[y * (GRID_X + 1) + x] = point / -point.z;
+		}
+	}
+
+	for (int z = 0; z < GRID_Z; z++)
+	{
+		float sliceNear = nearPlane * std::pow(farPlane / nearPlane, (float)z / GRID_Z);
+		float sliceFar = nearPlane * std::pow(farPlane / nearPlane, (float)(z + 1) / GRID_Z);
+		for (int y = 0; y < GRID_Y; y++)
+		{
+			for (int x = 0; x < GRID_X; x++)
+			{
+				glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+				for (int corner = 0; corner < 4; corner++)
+				{
+					const glm::vec3& ray = rays[(y + corner / 2) * (GRID_X + 1) + x + corner % 2];
+					for (float depth : { sliceNear, sliceFar })
+					{
+						boxMin = glm::min(boxMin, ray * depth);
+						boxMax = glm::max(boxMax, ray * depth);
+					}
+				}
+
+				int cluster = (z * GRID_Y + y) * GRID_X + x;
+				m_minX[cluster] = boxMin.x; m_minY[cluster] = boxMin.y; m_minZ[cluster] = boxMin.z;
+				m_maxX[cluster] = boxMax.x; m_maxY[cluster] = boxMax.y; m_maxZ[cluster] = boxMax.z;
+			}
+		}
+	}
+
+	// slice = log(depth) * scale + bias, as 2.2.2.pbr.fs computes it
+	float scale = GRID_Z / std::log(farPlane / nearPlane);
+	m_depthScaleBias = glm::vec2(scale, -scale * std::log(nearPlane));
+}
+
+void LightClusters::AssignSlice(int slice)
+{
+	int firstCluster = slice * TILES_PER_SLICE;
+	std::fill(m_counts.begin() + firstCluster, m_counts.begin() + firstCluster + TILES_PER_SLICE, 0);
+
+	for (size_t l = 0; l < m_spheres.size(); l++)
+	{
+		if (slice < m_firstSlice[l] || slice > m_lastSlice[l])
+			continue;
+
+		const glm::vec4& sphere = m_spheres[l];
+#ifdef LIGHT_CLUSTERS_SSE
+		__m128 cx = _mm_set1_ps(sphere.x), cy = _mm_set1_ps(sphere.y), cz = _mm_set1_ps(sphere.z);
+		__m128 radius2 = _mm_set1_ps(sphere.w * sphere.w);
+		__m128 zero = _mm_setzero_ps();
+
+		for (int i = firstCluster; i < firstCluster + TILES_PER_SLICE; i += 4)
+		{
+			// distance from the center to each box, per axis the part outside [min, max]
+			__m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minX[i]), cx), zero), _mm_max_ps(_mm_sub_ps(cx, _mm_loadu_ps(&m_maxX[i])), zero));
+			__m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minY[i]), cy), zero), _mm_max_ps(_mm_sub_ps(cy, _mm_loadu_ps(&m_maxY[i])), zero));
+			__m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minZ[i]), cz), zero), _mm_max_ps(_mm_sub_ps(cz, _mm_loadu_ps(&m_maxZ[i])), zero));
+			__m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+			int mask = _mm_movemask_ps(_mm_cmple_ps(distance2, radius2));
+			if (mask == 0)
+				continue;
+			for (int lane = 0; lane < 4; lane++)
+			{
+				int cluster = i + lane;
+				if ((mask & (1 << lane)) && m_counts[cluster] < MAX_LIGHTS_PER_CLUSTER)
+					m_slots[(size_t)cluster * MAX_LIGHTS_PER_CLUSTER + m_counts[cluster]++] = (uint32_t)l;
+			}
+		}
+#else
+		float radius2 = sphere.w * sphere.w;
+		for (int cluster = firstCluster; cluster < firstCluster + TILES_PER_SLICE; cluster++)
+		{
+			float dx = std::max(m_minX[cluster] - sphere.x, 0.0f) + std::max(sphere.x - m_maxX[cluster], 0.0f);
+			float dy = std::max(m_minY[cluster] - sphere.y, 0.0f) + std::max(sphere.y - m_maxY[cluster], 0.0f);
+			float dz = std::max(m_minZ[cluster] - sphere.z, 0.0f) + std::max(sphere.z - m_maxZ[cluster], 0.0f);
+			if (dx * dx + dy * dy + dz * dz <= radius2 && m_counts[cluster] < MAX_LIGHTS_PER_CLUSTER)
+				m_slots[(size_t)cluster * MAX_LIGHTS_PER_CLUSTER + m_counts[cluster]++] = (uint32_t)l;
+		}
+#endif
+	}
+}
+
+void LightClusters::Update(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, const glm::vec2& screenSize)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	Assign(lights, view, projection, nearPlane, farPlane, screenSize);
+	Upload();
+	m_lastMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void LightClusters::Assign(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, const glm::vec2& screenSize)
+{
+	if (projection != m_projection || nearPlane != m_near || farPlane != m_far)
+		BuildClusters(projection, nearPlane, farPlane);
+	m_tileSize = screenSize / glm::vec2(GRID_X, GRID_Y);
+
+	// view space spheres of the point and spot lights, directional ones light everything and aren't clustered
+	m_spheres.clear();
+	m_firstSlice.clear();
+	m_lastSlice.clear();
+	m_lightData.clear();
+	m_lightData.reserve(lights.size() * LIGHT_TEXELS);
+	float logRatio = std::log(farPlane / nearPlane);
+	auto sliceOf = [&](float depth) {
+		return std::clamp((int)std::floor(std::log(std::max(depth, nearPlane) / nearPlane) / logRatio * GRID_Z), 0, GRID_Z - 1);
+	};
+	for (const Light& light : lights)
+	{
+		if ((light.type != LightType::Point && light.type != LightType::Spot) || light.range <= 0.0f)
+			continue;
+
+		glm::vec4 sphere = BoundingSphere(light);
+		glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(sphere), 1.0f));
+		float nearest = -center.z - sphere.w, farthest = -center.z + sphere.w;
+		if (farthest < nearPlane || nearest > farPlane)
+			continue;
+
+		m_spheres.push_back(glm::vec4(center, sphere.w));
+		m_firstSlice.push_back(sliceOf(nearest));
+		m_lastSlice.push_back(sliceOf(farthest));
+
+		// world space for the shader; point lights get a cone wider than any direction
+		bool spot = light.type == LightType::Spot;
+		float cosInner = spot ? std::cos(glm::radians(light.innerAngle)) : -1.0f;
+		float cosOuter = spot ? std::cos(glm::radians(light.outerAngle)) : -2.0f;
+		m_lightData.push_back(glm::vec4(light.position, light.range));
+		m_lightData.push_back(glm::vec4(light.color * light.intensity, cosInner));
+		m_lightData.push_back(glm::vec4(spot ? glm::normalize(light.direction) : glm::vec3(0.0f, -1.0f, 0.0f), cosOuter));
+	}
+	m_lightCount = m_spheres.size();
+	m_assignments = 0;
+	m_maxPerCluster = 0;
+	if (m_lightCount == 0)
+		return;
+
+	if (m_parallel)
+		JobSystem::ParallelFor(GRID_Z, [this](int slice) { AssignSlice(slice); });
+	else
+		for (int slice = 0; slice < GRID_Z; slice++)
+			AssignSlice(slice);
+
+	// cluster records (first index, count) two per texel, then the indices four per texel
+	m_clusterData.assign(CLUSTER_COUNT / 2, glm::uvec4(0));
+	for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+	{
+		m_clusterData[cluster / 2][(cluster % 2) * 2] = (uint32_t)m_assignments;
+		m_clusterData[cluster / 2][(cluster % 2) * 2 + 1] = (uint32_t)m_counts[cluster];
+		m_assignments += m_counts[cluster];
+		m_maxPerCluster = std::max(m_maxPerCluster, m_counts[cluster]);
+	}
+	m_clusterData.resize(CLUSTER_COUNT / 2 + (m_assignments + 3) / 4, glm::uvec4(0));
+	uint32_t* indices = glm::value_ptr(m_clusterData[0]) + CLUSTER_COUNT * 2;
+	for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+	{
+		const uint32_t* slots = &m_slots[(size_t)cluster * MAX_LIGHTS_PER_CLUSTER];
+		indices = std::copy(slots, slots + m_counts[cluster], indices);
+	}
+}
+
+void LightClusters::Upload()
+{
+	// nothing to shade with, the shader skips the lookups
+	m_clusterBase = -1;
+	if (m_lightCount == 0)
+		return;
+
+	size_t lightOffset, clusterOffset;
+	if (!StreamBuffer::Write(m_lightData.data(), m_lightData.size() * sizeof(glm::vec4), sizeof(glm::vec4), lightOffset)
+		|| !StreamBuffer::Write(m_clusterData.data(), m_clusterData.size() * sizeof(glm::uvec4), sizeof(glm::uvec4), clusterOffset))
+		return;
+	m_lightBase = (int)(lightOffset / sizeof(glm::vec4));
+	m_clusterBase = (int)(clusterOffset / sizeof(glm::uvec4));
+	m_indexBase = m_clusterBase + CLUSTER_COUNT / 2;
+}
+
+void LightClusters::Bind(Shader& shader) const
+{
+	shader.use();
+	shader.setInt("lightData", LIGHT_TEXTURE_UNIT);
+	shader.setInt("clusterData", CLUSTER_TEXTURE_UNIT);
+	shader.setInt("lightBase", m_lightBase);
+	shader.setInt("clusterBase", m_clusterBase);
+	shader.setInt("indexBase", m_indexBase);
+	shader.setVec2("clusterTileSize", m_tileSize);
+	shader.setVec2("clusterDepth", m_depthScaleBias);
+
+	glActiveTexture(GL_TEXTURE0 + LIGHT_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_lightTexture);
+	glActiveTexture(GL_TEXTURE0 + CLUSTER_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_clusterTexture);
+	glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/shader_m.h>
+
+#include "Light.h"
+
+#include <cstdint>
+#include <vector>
+
+// Clustered forward lighting. The camera's view is split into GRID_X x GRID_Y screen tiles and GRID_Z depth slices
+// (exponential, so near clusters stay small); every point and spot light is assigned on the CPU to the clusters its
+// range touches, and a fragment only loops over the lights of its own cluster. Shading cost follows the lights near
+// a pixel instead of all of them.
+//
+// The cluster boxes are rebuilt when the projection changes. The assignment tests each light's bounding sphere against
+// four cluster boxes at a time with SSE, one depth slice per job on the JobSystem; slices only write their own
+// clusters, so the workers never share anything. Light data, cluster records and light indices are written to the
+// StreamBuffer each frame and read through two texture buffers over it (see 2.2.2.pbr.fs).
+//
+// per frame: Update with the lights and the camera, then Bind on every shader that shades with them
+class LightClusters
+{
+public:
+	static const int GRID_X = 16;
+	static const int GRID_Y = 9;
+	static const int GRID_Z = 24;
+	static const int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+	// lights past this many in one cluster are left out of it
+	static const int MAX_LIGHTS_PER_CLUSTER = 128;
+
+	// texture units of the light data and the cluster records, after the bone palette
+	static const int LIGHT_TEXTURE_UNIT = 10;
+	static const int CLUSTER_TEXTURE_UNIT = 11;
+
+	~LightClusters();
+
+	void Init();
+
+	// Assign, then Upload. nearPlane/farPlane bound the slices, not the projection: fragments beyond farPlane get no local lights
+	void Update(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, const glm::vec2& screenSize);
+
+	// the CPU side alone: builds the lists without writing them anywhere, what the light benchmark times
+	void Assign(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, const glm::vec2& screenSize);
+	// writes the lists of the last Assign to the StreamBuffer
+	void Upload();
+
+	// points shader at this frame's lists, binds the texture buffers and leaves GL_TEXTURE0 active
+	void Bind(Shader& shader) const;
+
+	// assign on the JobSystem (default) or all on the calling thread, for comparison
+	void SetParallel(bool enabled) { m_parallel = enabled; }
+
+	// of the last Update: lights assigned, light/cluster pairs, the fullest cluster, and the CPU time spent
+	size_t GetLightCount() const { return m_lightCount; }
+	size_t GetAssignmentCount() const { return m_assignments; }
+	int GetMaxPerCluster() const { return m_maxPerCluster; }
+	double GetLastMs() const { return m_lastMs; }
+
+private:
+	void BuildClusters(const glm::mat4& projection, float nearPlane, float farPlane);
+	void AssignSlice(int slice);
+
+	// view space cluster boxes as structure of arrays, cluster = (z * GRID_Y + y) * GRID_X + x
+	std::vector<float> m_minX, m_minY, m_minZ, m_maxX, m_maxY, m_maxZ;
+	glm::mat4 m_projection = glm::mat4(0.0f);
+	float m_near = 0.0f, m_far = 0.0f;
+
+	// this frame's view space bounding spheres, with the range of slices each one touches
+	std::vector<glm::vec4> m_spheres;
+	std::vector<int> m_firstSlice, m_lastSlice;
+
+	// MAX_LIGHTS_PER_CLUSTER slots per cluster, filled per slice, then packed behind the cluster records
+	std::vector<uint32_t> m_slots;
+	std::vector<int> m_counts;
+	std::vector<glm::vec4> m_lightData;
+	std::vector<glm::uvec4> m_clusterData;
+
+	unsigned int m_lightTexture = 0;
+	unsigned int m_clusterTexture = 0;
+	int m_lightBase = -1;
+	int m_clusterBase = -1;
+	int m_indexBase = -1;
+	glm::vec2 m_tileSize = glm::vec2(1.0f);
+	glm::vec2 m_depthScaleBias = glm::vec2(0.0f);
+
+	bool m_parallel = true;
+	size_t m_lightCount = 0;
+	size_t m_assignments = 0;
+	int m_maxPerCluster = 0;
+	double m_lastMs = 0.0;
+};
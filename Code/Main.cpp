@@ -1,8 +1,10 @@
 #include "Application.h"
 #include "Renderer.h"
+#include "AssetManager.h"
 
 #include "Model_DAEstatic.h"
 #include <learnopengl/model.h>
+#include <learnopengl/cooked_ibl.h>
 
 #include "B_Player.h"
 #include "B_Camera.h"
@@ -12,17 +14,87 @@
 
 #include "FontSystem.h"
 
+#include "JobSystem.h"
+#include "TextureStreamer.h"
+#include "FrustumCuller.h"
+#include "StaticBVH.h"
+#include "OcclusionCuller.h"
+#include "StaticBatch.h"
+#include "StreamBuffer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+
  
-int main()
+int main(int argc, char** argv)
 {
+    auto StartupBegin = std::chrono::high_resolution_clock::now();
+
+    auto HasArg = [argc, argv](const char* flag)
+    {
+        for (int i = 1; i < argc; i++)
+            if (std::string(argv[i]) == flag)
+                return true;
+        return false;
+    };
+    auto ArgValue = [argc, argv](const char* flag, double fallback)
+    {
+        for (int i = 1; i + 1 < argc; i++)
+            if (std::string(argv[i]) == flag)
+                return std::atof(argv[i + 1]);
+        return fallback;
+    };
+
+    // --serial-load imports everything on the main thread before the first frame, for comparison
+    bool SerialLoad = HasArg("--serial-load");
+    // --raw-textures skips the cooked textures and decodes/mipmaps the sources at load, for comparison
+    CookedTexture::s_enabled = !HasArg("--raw-textures");
+    // --texture-budget <MB> caps the streamed texture memory, 0 keeps every mip chain fully resident
+    double TextureBudgetMB = ArgValue("--texture-budget", 256.0);
+    TextureStreamer::Init((size_t)(TextureBudgetMB * 1024 * 1024), TextureBudgetMB > 0 ? 128 : 0);
+    // --no-lod draws every mesh at full detail, for comparison
+    Lod::s_enabled = !HasArg("--no-lod");
+    // --no-cull draws every renderable whatever the camera sees, for comparison
+    bool FrustumCulling = !HasArg("--no-cull");
+    // --no-occlusion skips the software occlusion pass, for comparison
+    bool OcclusionCulling = !HasArg("--no-occlusion");
+    // --stress-bullets <count> parks that many bullets in a grid once the assets are in, to load the instanced static path
+    int StressBullets = (int)ArgValue("--stress-bullets", 0.0);
+    // --no-static-batch draws the level cluster by cluster through the RenderQueue instead of its merged batches, for comparison
+    bool StaticBatching = !HasArg("--no-static-batch");
+    // --bitmap-font builds every fixed size glyph atlas at startup instead of SDF glyphs on first use, for comparison
+    OpenGLFontSystem::s_sdf = !HasArg("--bitmap-font");
+    // --no-program-cache compiles and links every shader from source, for comparison
+    ProgramCache::s_enabled = !HasArg("--no-program-cache");
+    // --no-ibl-cache renders the irradiance, prefilter and BRDF maps from the HDR every start, for comparison
+    CookedIBL::s_enabled = !HasArg("--no-ibl-cache");
+    // --shadows renders the sun's shadow map every frame; --no-shadow-cache redraws its static casters every frame too, for comparison
+    bool Shadows = HasArg("--shadows");
+    bool ShadowCaching = !HasArg("--no-shadow-cache");
+    // --bench-lights <count> scatters that many point and spot lights over the level once the assets are in and times their clustering
+    int BenchLights = (int)ArgValue("--bench-lights", 0.0);
+
     Application app;
     Renderer renderer;
     glfwSwapInterval(0);
+    CookedTexture::DetectSupport();
+
+    GLUploadQueue::SetMainThread();
+    JobSystem::Init(SerialLoad ? 0 : std::max(2u, std::thread::hardware_concurrency()) - 1);
+    std::cout << "Asset loading: " << (SerialLoad ? "serial" : std::to_string(JobSystem::GetWorkerCount()) + " workers") << std::endl;
+
     Doozy::Load();
     Steve::Load();
 
 
     OpenGLFontSystem fontSystem;
+    ProgramCache::Report();
 
     //Camera
     GameObj* CameraOBJ = GameObj::Create();
@@ -35,7 +107,8 @@ int main()
 
     //Scene
     GameObj* SceneOBJ = GameObj::Create();
-        Model_Static Model_Racetrack("Assets/Models/castle/Castle OBJ.obj");
+        AssetHandle<Model_Static> Model_Racetrack;
+        JobSystem::Submit([&Model_Racetrack]() { Model_Racetrack = AssetManager::LoadModelStatic("Assets/Models/castle/Castle OBJ.obj"); });
         SceneOBJ->Transform.wPosition = glm::vec3(30, 0, 30);
         SceneOBJ->Transform.wRotation = glm::vec3(0, 0, 0);
         SceneOBJ->Transform.wScale = glm::vec3(10.0f, 10.0f, 10.0f);
@@ -48,6 +121,33 @@ int main()
 
 
 
+    bool AssetsReady = false;
+    bool FirstFrame = true;
+    auto StartupMs = [&StartupBegin]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartupBegin).count();
+    };
+
+    double StatsTimer = glfwGetTime();
+    int StatsFrames = 0;
+    Lod::Selection CastleLod;
+    FrustumCuller SceneCuller;
+    std::vector<int> CullSlots;
+    StaticBVH CastleBVH;
+    std::vector<unsigned int> CastleClusters;
+    StaticBatch CastleBatch;
+    OcclusionCuller SceneOcclusion;
+    // level clusters smaller than this on screen hide too little to be worth rasterizing
+    const float OccluderMinPixels = 64.0f;
+    std::vector<glm::vec3> OccludeeCenters, OccludeeExtents;
+    std::vector<size_t> OccludeeObjects;
+    std::vector<uint8_t> OccludeeVisible, Occluded;
+    // the sun, and how far from the camera its shadows are drawn
+    const glm::vec3 SunDirection = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+    const float ShadowDistance = 60.0f;
+    FrustumCuller ShadowCuller;
+    std::vector<unsigned int> ShadowClusters;
+    renderer.GetShadowCache().SetCaching(ShadowCaching);
+
     BanKEngine::Init();
     while (!app.WindowShouldClose())
     {
@@ -57,45 +157,261 @@ int main()
 
         app.ProcessInput();
 
+        // finished imports are uploaded a few at a time so loading never stalls a frame for long
+        GLUploadQueue::Process(4.0);
+        if (!AssetsReady) {
+            // idle must be checked first, jobs push their upload before they count as finished
+            if (JobSystem::IsIdle() && GLUploadQueue::IsEmpty()) {
+                AssetsReady = true;
+                std::cout << "\n[Startup] assets ready after " << StartupMs() << " ms" << std::endl;
+                AssetManager::Report();
+            }
+        }
+
+        // F2 toggles instanced skinning to compare against one draw per character
+        if (Input::GetKeyDown(GLFW_KEY_F2)) {
+            renderer.m_skinnedInstancing = !renderer.m_skinnedInstancing;
+            std::cout << "\nSkinned instancing: " << (renderer.m_skinnedInstancing ? "ON" : "OFF") << std::endl;
+        }
+        if (Input::GetKeyDown(GLFW_KEY_F3))
+            AssetManager::Report();
+        if (Input::GetKeyDown(GLFW_KEY_F4))
+            TextureStreamer::Report();
+        // F5 toggles instancing of repeated static meshes
+        if (Input::GetKeyDown(GLFW_KEY_F5)) {
+            renderer.m_staticInstancing = !renderer.m_staticInstancing;
+            std::cout << "\nStatic instancing: " << (renderer.m_staticInstancing ? "ON" : "OFF") << std::endl;
+        }
+
 
         // Render
         renderer.Clear();
+        StreamBuffer::BeginFrame();
+        TextureStreamer::BeginFrame(CameraOBJ->Transform.wPosition, Camera_Bhav->m_fov, app.GetWindowSize().y);
+        Lod::BeginFrame(CameraOBJ->Transform.wPosition, Camera_Bhav->m_fov, app.GetWindowSize().y);
          
-        renderer.m_animShader.use(); 
-        renderer.m_animShader.setMat4("projection", Camera_Bhav->GetProjectionMatrix());
-        renderer.m_animShader.setMat4("view", Camera_Bhav->GetViewMatrix());
-
+        // one upload of the camera for every shader, see FrameUniforms
+        renderer.UpdateFrameData(Camera_Bhav->GetViewMatrix(), Camera_Bhav->GetProjectionMatrix(), CameraOBJ->Transform.wPosition);
+        renderer.UpdateLights();
 
         SceneOBJ->Transform.wPosition = glm::vec3(0); 
         Shader& Shader4Static = renderer.m_basicShader; 
-        Shader4Static.use();
-        Shader4Static.setMat4("projection", Camera_Bhav->GetProjectionMatrix());
-        Shader4Static.setMat4("view", Camera_Bhav->GetViewMatrix());
 
-        for (GameObj* EACH : sGameObjs) {
-            EACH->Render(renderer);
+        auto submitStart = std::chrono::high_resolution_clock::now();
+
+        // every renderable with bounds is tested against the camera in one batch before any draw, -1 = always drawn
+        Frustum CameraFrustum = createFrustumFromMatrix(Camera_Bhav->GetProjectionMatrix() * Camera_Bhav->GetViewMatrix());
+        SceneCuller.Clear();
+        CullSlots.assign(sGameObjs.size(), -1);
+        for (size_t i = 0; i < sGameObjs.size(); i++) {
+            if (sGameObjs[i]->HasBounds)
+                CullSlots[i] = (int)SceneCuller.Add(sGameObjs[i]->BoundsCenter, sGameObjs[i]->BoundsExtents);
+        }
+        if (FrustumCulling)
+            SceneCuller.Cull(CameraFrustum);
+        auto IsFrustumCulled = [&](size_t i) { return FrustumCulling && CullSlots[i] >= 0 && !SceneCuller.IsVisible(CullSlots[i]); };
+        renderer.m_stats.visible += FrustumCulling ? SceneCuller.GetVisibleCount() : SceneCuller.GetCount();
+        renderer.m_stats.culled += FrustumCulling ? SceneCuller.GetCount() - SceneCuller.GetVisibleCount() : 0;
+
+        // the level is culled cluster by cluster through its hierarchy
+        if (AssetsReady && !CastleBVH.IsBuilt()) {
+            CastleBVH.Build(*Model_Racetrack, glm::mat4(1.0f));
+            // the level's shadow has to be drawn again whenever the static geometry changes
+            renderer.GetShadowCache().Invalidate();
+        }
+        if (AssetsReady && StaticBatching && !CastleBatch.IsBuilt())
+            CastleBatch.Build(*Model_Racetrack, glm::mat4(1.0f));
+        if (AssetsReady) {
+            if (FrustumCulling) {
+                CastleBVH.Cull(CameraFrustum, CastleClusters);
+            }
+            else {
+                CastleClusters.resize(Model_Racetrack->meshes.size());
+                for (unsigned int i = 0; i < CastleClusters.size(); i++)
+                    CastleClusters[i] = i;
+            }
+            renderer.m_stats.clustersVisible += CastleClusters.size();
+            renderer.m_stats.clustersCulled += CastleBVH.GetClusterCount() - CastleClusters.size();
         }
 
-        // Rendering static models
-        Shader& basicShader = renderer.m_basicShader;
+        // the big level clusters in view are rasterized on the CPU, then every object that passed the frustum is tested behind them
+        Occluded.assign(sGameObjs.size(), 0);
+        if (OcclusionCulling && AssetsReady) {
+            SceneOcclusion.Begin(Camera_Bhav->GetProjectionMatrix() * Camera_Bhav->GetViewMatrix());
+            for (unsigned int i : CastleClusters) {
+                const Mesh& mesh = Model_Racetrack->meshes[i];
+                if (Lod::ScreenSize(mesh.boundsCenter, mesh.boundsRadius) >= OccluderMinPixels)
+                    SceneOcclusion.AddOccluder(mesh.occluderPositions, mesh.occluderIndices, glm::mat4(1.0f));
+            }
+            SceneOcclusion.Rasterize();
+
+            OccludeeCenters.clear();
+            OccludeeExtents.clear();
+            OccludeeObjects.clear();
+            for (size_t i = 0; i < sGameObjs.size(); i++) {
+                if (CullSlots[i] >= 0 && !IsFrustumCulled(i)) {
+                    OccludeeCenters.push_back(sGameObjs[i]->BoundsCenter);
+                    OccludeeExtents.push_back(sGameObjs[i]->BoundsExtents);
+                    OccludeeObjects.push_back(i);
+                }
+            }
+            OccludeeVisible.assign(OccludeeObjects.size(), 1);
+            SceneOcclusion.TestBoxes(OccludeeCenters.data(), OccludeeExtents.data(), OccludeeObjects.size(), OccludeeVisible.data());
+            for (size_t i = 0; i < OccludeeObjects.size(); i++)
+                Occluded[OccludeeObjects[i]] = !OccludeeVisible[i];
+
+            renderer.m_stats.occlusionTested += OccludeeObjects.size();
+            renderer.m_stats.occluded += std::count(Occluded.begin(), Occluded.end(), 1);
+        }
+        auto IsCulled = [&](size_t i) { return IsFrustumCulled(i) || Occluded[i]; };
+
+        // the sun's shadow map: the level only when the light's box moved, then everything that moves on top of it
+        if (Shadows && AssetsReady) {
+            glm::mat4 View = Camera_Bhav->GetViewMatrix();
+            glm::vec3 CameraForward = -glm::vec3(View[0][2], View[1][2], View[2][2]);
+            glm::vec3 FocusCenter, CastleCenter, CastleExtents;
+            float FocusRadius;
+            ShadowCache::FitCameraSphere(CameraOBJ->Transform.wPosition, CameraForward, glm::radians(Camera_Bhav->m_fov),
+                app.GetWindowSize().x / app.GetWindowSize().y, 0.1f, ShadowDistance, FocusCenter, FocusRadius);
+            transformAABB(glm::mat4(1.0f), Model_Racetrack->boundsMin, Model_Racetrack->boundsMax, CastleCenter, CastleExtents);
+
+            if (renderer.BeginShadows(SunDirection, FocusCenter, FocusRadius, CastleCenter, glm::length(CastleExtents))) {
+                CastleBVH.Cull(createFrustumFromMatrix(renderer.GetShadowMatrix()), ShadowClusters);
+                if (StaticBatching)
+                    renderer.DrawStaticShadows(CastleBatch, ShadowClusters);
+                else
+                    renderer.SubmitStatic(Shader4Static, *Model_Racetrack, glm::mat4(1.0f), nullptr, &ShadowClusters);
+            }
+            renderer.BeginDynamicShadows();
+
+            // slots line up with the camera's culler, the same boxes are added in the same order
+            ShadowCuller.Clear();
+            for (size_t i = 0; i < sGameObjs.size(); i++) {
+                if (CullSlots[i] >= 0)
+                    ShadowCuller.Add(sGameObjs[i]->BoundsCenter, sGameObjs[i]->BoundsExtents);
+            }
+            ShadowCuller.Cull(createFrustumFromMatrix(renderer.GetShadowMatrix()));
+            for (size_t i = 0; i < sGameObjs.size(); i++) {
+                if (CullSlots[i] < 0 || ShadowCuller.IsVisible(CullSlots[i]))
+                    sGameObjs[i]->Render(renderer);
+            }
+            renderer.EndShadows();
+        }
 
-        basicShader.use();
-        basicShader.setMat4("projection", Camera_Bhav->GetProjectionMatrix());
-        basicShader.setMat4("view", Camera_Bhav->GetViewMatrix());
+        renderer.BeginStatic(CameraOBJ->Transform.wPosition);
+        for (size_t i = 0; i < sGameObjs.size(); i++) {
+            if (!IsCulled(i))
+                sGameObjs[i]->Render(renderer);
+        }
 
-        glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f));
-        basicShader.setMat4("model", model);
-        basicShader.setMat4("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+        // the level's visible clusters are drawn from its merged batches, or sorted together with the props without them
+        if (AssetsReady && !StaticBatching)
+            renderer.SubmitStatic(Shader4Static, *Model_Racetrack, glm::mat4(1.0f), &CastleLod, &CastleClusters);
 
-        Model_Racetrack.Draw(basicShader);
+        renderer.FlushStatic();
+        if (AssetsReady && StaticBatching)
+            renderer.DrawStaticBatch(Shader4Static, CastleBatch, *Model_Racetrack, CastleClusters, CastleLod);
+        renderer.FlushSkinned();
+        renderer.m_stats.submitMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - submitStart).count();
 
         fontSystem.RenderText("I am a hero", { 100, 100 }, 24, glm::vec4(1.0f));
 
         app.SwapBuffers();
+
+        if (FirstFrame) {
+            FirstFrame = false;
+            std::cout << "\n[Startup] time to first frame: " << StartupMs() << " ms" << std::endl;
+        }
+
+        // texture detail requested by this frame's draws
+        TextureStreamer::Update();
+
+        renderer.m_stats.drawCalls += Mesh::s_drawCalls;
+        Mesh::s_drawCalls = 0;
+        renderer.m_stats.triangles += Mesh::s_triangles;
+        Mesh::s_triangles = 0;
+        renderer.m_stats.uniformCalls += Shader::s_uniformCalls;
+        Shader::s_uniformCalls = 0;
+        renderer.m_stats.uniformLookups += Shader::s_locationLookups;
+        Shader::s_locationLookups = 0;
+        renderer.m_stats.streamedBytes += StreamBuffer::s_bytesWritten;
+        StreamBuffer::s_bytesWritten = 0;
+        renderer.m_stats.streamStalls += StreamBuffer::s_stalls;
+        StreamBuffer::s_stalls = 0;
+        renderer.m_stats.streamDrops += StreamBuffer::s_drops;
+        StreamBuffer::s_drops = 0;
+        StatsFrames++;
+        if (glfwGetTime() - StatsTimer > 1.0) {
+            renderer.m_stats.submitMs /= StatsFrames;
+            renderer.m_stats.drawCalls /= StatsFrames;
+            renderer.m_stats.triangles /= StatsFrames;
+            renderer.m_stats.visible /= StatsFrames;
+            renderer.m_stats.culled /= StatsFrames;
+            renderer.m_stats.clustersVisible /= StatsFrames;
+            renderer.m_stats.clustersCulled /= StatsFrames;
+            renderer.m_stats.occlusionTested /= StatsFrames;
+            renderer.m_stats.occluded /= StatsFrames;
+            renderer.m_stats.skinnedInstances /= StatsFrames;
+            renderer.m_stats.queuedDraws /= StatsFrames;
+            renderer.m_stats.programChanges /= StatsFrames;
+            renderer.m_stats.vaoChanges /= StatsFrames;
+            renderer.m_stats.textureChanges /= StatsFrames;
+            renderer.m_stats.redundantBinds /= StatsFrames;
+            renderer.m_stats.staticInstances /= StatsFrames;
+            renderer.m_stats.batchDraws /= StatsFrames;
+            renderer.m_stats.batchRanges /= StatsFrames;
+            renderer.m_stats.uniformCalls /= StatsFrames;
+            renderer.m_stats.uniformLookups /= StatsFrames;
+            renderer.m_stats.streamedBytes /= StatsFrames;
+            renderer.m_stats.shadowDraws /= StatsFrames;
+            renderer.m_stats.lights /= StatsFrames;
+            renderer.m_stats.lightAssignments /= StatsFrames;
+            renderer.m_stats.lightMs /= StatsFrames;
+            renderer.m_stats.Print();
+            renderer.m_stats.Reset();
+            StatsTimer = glfwGetTime();
+            StatsFrames = 0;
+        }
          
 
         /////////////////////// TEMPORARY WORKSPACE  ///////////
 
+        // characters and props need their models
+        if (!AssetsReady)
+            continue;
+
+        if (StressBullets > 0) {
+            int Side = (int)std::ceil(std::sqrt((double)StressBullets));
+            for (int i = 0; i < StressBullets; i++) {
+                GameObj* BulletOBJ = GameObj::Create();
+                BulletOBJ->Transform.wPosition = glm::vec3((i % Side - Side * 0.5f) * 0.4f, 1.0f, (i / Side - Side * 0.5f) * 0.4f);
+                Bullet* StressBullet = BulletOBJ->AddComponent(new Bullet(Steve::Data_->Bullet_Model.get(), false));
+                StressBullet->Speed = 0.0f;
+                StressBullet->lifespan = FLT_MAX;
+            }
+            std::cout << "\n[Stress] " << StressBullets << " bullets spawned" << std::endl;
+            StressBullets = 0;
+        }
+
+        if (BenchLights > 0) {
+            glm::vec3 Center, Extents;
+            transformAABB(glm::mat4(1.0f), Model_Racetrack->boundsMin, Model_Racetrack->boundsMax, Center, Extents);
+            std::mt19937 Random(1);
+            std::uniform_real_distribution<float> Unit(-1.0f, 1.0f);
+            for (int i = 0; i < BenchLights; i++) {
+                Light BenchLight(Center + Extents * glm::vec3(Unit(Random), Unit(Random), Unit(Random)),
+                    glm::vec3(1.0f) + 0.5f * glm::vec3(Unit(Random), Unit(Random), Unit(Random)));
+                // one in four a spot pointing down
+                BenchLight.type = i % 4 == 3 ? LightType::Spot : LightType::Point;
+                BenchLight.direction = glm::vec3(Unit(Random) * 0.5f, -1.0f, Unit(Random) * 0.5f);
+                BenchLight.range = 8.0f + 4.0f * Unit(Random);
+                BenchLight.intensity = 20.0f;
+                renderer.GetLights().push_back(BenchLight);
+            }
+            renderer.BenchmarkLights(100);
+            BenchLights = 0;
+        }
+
         if (sGetComponent_OfClass(Player_Bhav)) {
                 float LerpSpeed = 16 * Time.Deltatime;
                 CameraOBJ->Transform.wPosition = B_lerpVec3(CameraOBJ->Transform.wPosition, Player_Bhav->CamSocket->Transform.getWorldPosition(), LerpSpeed);
@@ -126,4 +442,6 @@ int main()
         }
       
     }
+
+    JobSystem::Shutdown();
 }
\ No newline at end of file
@@ -8,7 +8,10 @@
 #include <string>
 #include <iostream>
 #include <GLFW/glfw3.h>
-#include <stb_image.h>  // Include stb_image for texture loading
+#include <learnopengl/texture_cache.h>
+#include <learnopengl/packed_vertex.h>
+#include <algorithm>
+#include <memory>
 
 // Structure to hold bone information
 struct BoneInfo_DAEstatic {
@@ -50,6 +53,7 @@ private:
     std::vector<glm::mat4> boneMatrices;  // Transforms for skeletal animation
     GLuint VAO, VBO, EBO;  // OpenGL buffers for rendering
     std::vector<GLuint> textures;  // Store loaded textures
+    std::vector<std::shared_ptr<CachedTexture>> textureRefs;  // keeps the cached textures alive
 };
 
 Model_DAEstatic::Model_DAEstatic(const std::string& dir) {
@@ -155,26 +159,10 @@ void Model_DAEstatic::loadBones(aiMesh* mesh) {
 }
 
 GLuint Model_DAEstatic::loadTexture(const std::string& texturePath) {
-    int width, height, channels;
-    unsigned char* data = stbi_load(texturePath.c_str(), &width, &height, &channels, 0);
-    if (!data) {
-        std::cerr << "Texture failed to load at path: " << texturePath << std::endl;
-        return 0;
-    }
-
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    stbi_image_free(data);
-    return textureID;
+    // shared with every other model through the TextureCache
+    std::shared_ptr<CachedTexture> texture = TextureCache::Acquire(texturePath);
+    textureRefs.push_back(texture);
+    return texture->Upload();
 }
 
 void Model_DAEstatic::SetBones(const std::vector<glm::mat4>& boneMatrices) {
@@ -188,32 +176,32 @@ void Model_DAEstatic::setupMesh() {
 
     glBindVertexArray(VAO);
 
-    // Vertex Buffer Object (VBO)
+    // Vertex Buffer Object (VBO), packed like every other mesh (see learnopengl/packed_vertex.h).
+    // The four strongest influences of each vertex are kept, the bone vector itself never goes to the GPU
+    std::vector<PackedSkinnedVertex> packed(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Vertex_DAEstatic& vertex = vertices[i];
+        packed[i].Base = PackedVertex::PackStatic(vertex.position, vertex.normal, vertex.texCoords, glm::vec3(0.0f), glm::vec3(0.0f));
+
+        std::vector<BoneInfo_DAEstatic> strongest = vertex.bones;
+        std::sort(strongest.begin(), strongest.end(), [](const BoneInfo_DAEstatic& a, const BoneInfo_DAEstatic& b) { return a.weight > b.weight; });
+        int boneIDs[4] = { -1, -1, -1, -1 };
+        float weights[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (size_t j = 0; j < strongest.size() && j < 4; j++) {
+            boneIDs[j] = (int)strongest[j].boneID;
+            weights[j] = strongest[j].weight;
+        }
+        PackedVertex::PackBones(boneIDs, weights, packed[i].BoneIDs, packed[i].Weights);
+    }
+
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex_DAEstatic), &vertices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedSkinnedVertex), packed.data(), GL_STATIC_DRAW);
 
     // Element Buffer Object (EBO)
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex_DAEstatic), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex_DAEstatic), (void*)offsetof(Vertex_DAEstatic, normal));
-    glEnableVertexAttribArray(1);
-
-    // Texture coordinates attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex_DAEstatic), (void*)offsetof(Vertex_DAEstatic, texCoords));
-    glEnableVertexAttribArray(2);
-
-    // Bone data (indices and weights)
-    glVertexAttribPointer(3, 4, GL_INT, GL_FALSE, sizeof(Vertex_DAEstatic), (void*)offsetof(Vertex_DAEstatic, bones));
-    glEnableVertexAttribArray(3);
-
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex_DAEstatic), (void*)(offsetof(Vertex_DAEstatic, bones) + sizeof(int) * 4));
-    glEnableVertexAttribArray(4);
+    PackedVertex::SetupAttributes(true);
 
     glBindVertexArray(0);
 }
@@ -0,0 +1,223 @@
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define OCCLUSION_CULLER_SSE 1
+#endif
+
+namespace
+{
+	// rows per rasterizer job, every job owns its rows of the depth buffer so no locking is needed
+	const int BAND_HEIGHT = 24;
+	// boxes per visibility job
+	const size_t BOXES_PER_JOB = 64;
+	// vertices closer than this (clip w) drop their triangle, an occluder crossing the near plane occludes a bit less
+	const float NEAR_W = 1e-3f;
+	const float EMPTY_DEPTH = FLT_MAX;
+}
+
+OcclusionCuller::OcclusionCuller()
+	: m_viewProjection(1.0f), m_depth((size_t)WIDTH * HEIGHT, EMPTY_DEPTH)
+{
+}
+
+void OcclusionCuller::Begin(const glm::mat4& viewProjection)
+{
+	m_viewProjection = viewProjection;
+	m_occluders.clear();
+	m_triangleCount = 0;
+	std::fill(m_depth.begin(), m_depth.end(), EMPTY_DEPTH);
+}
+
+void OcclusionCuller::AddOccluder(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices, const glm::mat4& modelMatrix)
+{
+	if (indices.empty())
+		return;
+
+	m_occluders.push_back(Occluder{ &positions, &indices, m_viewProjection * modelMatrix, {} });
+	m_triangleCount += indices.size() / 3;
+}
+
+void OcclusionCuller::TransformOccluder(Occluder& occluder) const
+{
+	const std::vector<glm::vec3>& positions = *occluder.positions;
+	occluder.screen.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		glm::vec4 clip = occluder.modelViewProjection * glm::vec4(positions[i], 1.0f);
+		if (clip.w < NEAR_W)
+		{
+			occluder.screen[i] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+			continue;
+		}
+
+		float invW = 1.0f / clip.w;
+		occluder.screen[i] = glm::vec4((clip.x * invW * 0.5f + 0.5f) * WIDTH, (0.5f - clip.y * invW * 0.5f) * HEIGHT, clip.z * invW, 1.0f);
+	}
+}
+
+void OcclusionCuller::Rasterize()
+{
+	JobSystem::ParallelFor((int)m_occluders.size(), [this](int i) { TransformOccluder(m_occluders[i]); });
+
+	int bands = (HEIGHT + BAND_HEIGHT - 1) / BAND_HEIGHT;
+	JobSystem::ParallelFor(bands, [this](int band) { RasterizeBand(band * BAND_HEIGHT, std::min(HEIGHT, (band + 1) * BAND_HEIGHT)); });
+}
+
+void OcclusionCuller::RasterizeBand(int firstRow, int endRow)
+{
+	for (const Occluder& occluder : m_occluders)
+	{
+		const std::vector<unsigned int>& indices = *occluder.indices;
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			glm::vec4 a = occluder.screen[indices[t]], b = occluder.screen[indices[t + 1]], c = occluder.screen[indices[t + 2]];
+			if (a.w < 0.0f || b.w < 0.0f || c.w < 0.0f)
+				continue;
+
+			int minX = std::max(0, (int)std::floor(std::min(a.x, std::min(b.x, c.x))));
+			int maxX = std::min(WIDTH - 1, (int)std::floor(std::max(a.x, std::max(b.x, c.x))));
+			int minY = std::max(firstRow, (int)std::floor(std::min(a.y, std::min(b.y, c.y))));
+			int maxY = std::min(endRow - 1, (int)std::floor(std::max(a.y, std::max(b.y, c.y))));
+			if (minX > maxX || minY > maxY)
+				continue;
+
+			// edge functions E(x, y) = A x + B y + C, positive inside once the winding is made consistent
+			float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+			if (std::abs(area) < 1e-6f)
+				continue;
+			if (area < 0.0f)
+			{
+				std::swap(b, c);
+				area = -area;
+			}
+
+			const glm::vec4* from[3] = { &b, &c, &a };
+			const glm::vec4* to[3] = { &c, &a, &b };
+			float edgeA[3], edgeB[3], edgeC[3];
+			for (int e = 0; e < 3; e++)
+			{
+				edgeA[e] = -(to[e]->y - from[e]->y);
+				edgeB[e] = to[e]->x - from[e]->x;
+				edgeC[e] = -(edgeA[e] * from[e]->x + edgeB[e] * from[e]->y);
+			}
+
+			// depth is linear in screen space: z = zA x + zB y + zC
+			float invArea = 1.0f / area;
+			float zA = (edgeA[0] * a.z + edgeA[1] * b.z + edgeA[2] * c.z) * invArea;
+			float zB = (edgeB[0] * a.z + edgeB[1] * b.z + edgeB[2] * c.z) * invArea;
+			float zC = (edgeC[0] * a.z + edgeC[1] * b.z + edgeC[2] * c.z) * invArea;
+
+			int startX = minX & ~3;
+			for (int y = minY; y <= maxY; y++)
+			{
+				float py = y + 0.5f;
+				float* row = &m_depth[(size_t)y * WIDTH];
+#ifdef OCCLUSION_CULLER_SSE
+				__m128 zero = _mm_setzero_ps();
+				__m128 w[3], stepW[3];
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)startX), _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+				for (int e = 0; e < 3; e++)
+				{
+					w[e] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[e]), px), _mm_set1_ps(edgeB[e] * py + edgeC[e]));
+					stepW[e] = _mm_set1_ps(edgeA[e] * 4.0f);
+				}
+				__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zA), px), _mm_set1_ps(zB * py + zC));
+				__m128 stepZ = _mm_set1_ps(zA * 4.0f);
+
+				for (int x = startX; x <= maxX; x += 4)
+				{
+					__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w[0], zero), _mm_cmpge_ps(w[1], zero)), _mm_cmpge_ps(w[2], zero));
+					if (_mm_movemask_ps(inside))
+					{
+						__m128 depth = _mm_loadu_ps(row + x);
+						__m128 nearer = _mm_min_ps(depth, z);
+						_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, depth)));
+					}
+					for (int e = 0; e < 3; e++)
+						w[e] = _mm_add_ps(w[e], stepW[e]);
+					z = _mm_add_ps(z, stepZ);
+				}
+#else
+				for (int x = minX; x <= maxX; x++)
+				{
+					float px = x + 0.5f;
+					bool inside = true;
+					for (int e = 0; e < 3; e++)
+						inside = inside && edgeA[e] * px + edgeB[e] * py + edgeC[e] >= 0.0f;
+					if (inside)
+						row[x] = std::min(row[x], zA * px + zB * py + zC);
+				}
+#endif
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::IsVisible(const glm::vec3& center, const glm::vec3& extents) const
+{
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 offset((corner & 1) ? extents.x : -extents.x, (corner & 2) ? extents.y : -extents.y, (corner & 4) ? extents.z : -extents.z);
+		glm::vec4 clip = m_viewProjection * glm::vec4(center + offset, 1.0f);
+		// reaching behind the camera, nothing can be said
+		if (clip.w < NEAR_W)
+			return true;
+
+		float invW = 1.0f / clip.w;
+		float x = (clip.x * invW * 0.5f + 0.5f) * WIDTH;
+		float y = (0.5f - clip.y * invW * 0.5f) * HEIGHT;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, clip.z * invW);
+	}
+
+	int x0 = std::max(0, (int)std::floor(minX)), x1 = std::min(WIDTH - 1, (int)std::floor(maxX));
+	int y0 = std::max(0, (int)std::floor(minY)), y1 = std::min(HEIGHT - 1, (int)std::floor(maxY));
+	if (x0 > x1 || y0 > y1)
+		return true;
+
+	// visible as soon as one covered pixel has no occluder in front of the box's nearest point
+	for (int y = y0; y <= y1; y++)
+	{
+		const float* row = &m_depth[(size_t)y * WIDTH];
+#ifdef OCCLUSION_CULLER_SSE
+		__m128 boxDepth = _mm_set1_ps(minZ);
+		for (int x = x0 & ~3; x <= x1; x += 4)
+		{
+			int lanes = 0xF;
+			if (x < x0)
+				lanes &= 0xF << (x0 - x);
+			if (x + 3 > x1)
+				lanes &= 0xF >> (x + 3 - x1);
+			if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth)) & lanes)
+				return true;
+		}
+#else
+		for (int x = x0; x <= x1; x++)
+			if (row[x] >= minZ)
+				return true;
+#endif
+	}
+	return false;
+}
+
+void OcclusionCuller::TestBoxes(const glm::vec3* centers, const glm::vec3* extents, size_t count, uint8_t* visible) const
+{
+	int jobs = (int)((count + BOXES_PER_JOB - 1) / BOXES_PER_JOB);
+	JobSystem::ParallelFor(jobs, [&](int job)
+	{
+		size_t end = std::min(count, (job + 1) * BOXES_PER_JOB);
+		for (size_t i = job * BOXES_PER_JOB; i < end; i++)
+			if (visible[i] && !IsVisible(centers[i], extents[i]))
+				visible[i] = 0;
+	});
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Software occlusion culling: a handful of big occluders (the level's full detail meshes) is rasterized on the CPU
+// into a small depth buffer, then renderable boxes are tested against it before anything is submitted.
+// Plain SSE code on the JobSystem, no GL involved, so it runs the same with or without a GPU context.
+//
+// per frame: Begin, AddOccluder for each occluder, Rasterize, then IsVisible / TestBoxes
+class OcclusionCuller
+{
+public:
+	static const int WIDTH = 320;	// multiple of 4, one SSE register covers four pixels of a row
+	static const int HEIGHT = 192;
+
+	OcclusionCuller();
+
+	// clears the depth buffer and forgets last frame's occluders
+	void Begin(const glm::mat4& viewProjection);
+
+	// the arrays must stay alive until Rasterize returns
+	void AddOccluder(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices, const glm::mat4& modelMatrix);
+
+	// transforms the occluders and fills the depth buffer, both spread over the JobSystem
+	void Rasterize();
+
+	// false only when the whole box is behind occluder depth
+	bool IsVisible(const glm::vec3& center, const glm::vec3& extents) const;
+
+	// IsVisible for many boxes on the JobSystem, visible[i] is cleared for occluded boxes and left alone otherwise
+	void TestBoxes(const glm::vec3* centers, const glm::vec3* extents, size_t count, uint8_t* visible) const;
+
+	size_t GetOccluderTriangles() const { return m_triangleCount; }
+
+private:
+	struct Occluder
+	{
+		const std::vector<glm::vec3>* positions;
+		const std::vector<unsigned int>* indices;
+		glm::mat4 modelViewProjection;
+		std::vector<glm::vec4> screen;	// x, y in pixels, z = ndc depth, w < 0 when behind the near plane
+	};
+
+	void TransformOccluder(Occluder& occluder) const;
+	void RasterizeBand(int firstRow, int endRow);
+
+	glm::mat4 m_viewProjection;
+	std::vector<Occluder> m_occluders;
+	std::vector<float> m_depth;
+	size_t m_triangleCount = 0;
+};
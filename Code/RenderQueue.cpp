@@ -0,0 +1,232 @@
+#include "RenderQueue.h"
+#include "StreamBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const int DEPTH_BITS = 22;
+	const uint32_t MAX_DEPTH = (1u << DEPTH_BITS) - 1;
+	// distances are stored logarithmically up to this, past it everything sorts as far
+	const float DEPTH_RANGE = 100000.0f;
+}
+
+void GLStateCache::Invalidate()
+{
+	m_program = UNKNOWN;
+	m_vao = UNKNOWN;
+	m_activeUnit = UNKNOWN;
+	std::fill(std::begin(m_textures), std::end(m_textures), UNKNOWN);
+}
+
+void GLStateCache::UseProgram(unsigned int program)
+{
+	if (program == m_program)
+	{
+		skipped++;
+		return;
+	}
+	glUseProgram(program);
+	m_program = program;
+	programChanges++;
+}
+
+void GLStateCache::BindVertexArray(unsigned int vao)
+{
+	if (vao == m_vao)
+	{
+		skipped++;
+		return;
+	}
+	glBindVertexArray(vao);
+	m_vao = vao;
+	vaoChanges++;
+}
+
+void GLStateCache::BindTexture(unsigned int unit, unsigned int texture)
+{
+	if (unit < TEXTURE_UNITS && m_textures[unit] == texture)
+	{
+		skipped++;
+		return;
+	}
+	if (unit != m_activeUnit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		m_activeUnit = unit;
+	}
+	glBindTexture(GL_TEXTURE_2D, texture);
+	if (unit < TEXTURE_UNITS)
+		m_textures[unit] = texture;
+	textureChanges++;
+}
+
+void GLStateCache::ResetCounters()
+{
+	programChanges = 0;
+	vaoChanges = 0;
+	textureChanges = 0;
+	skipped = 0;
+}
+
+void RenderQueue::SetInstancedShader(Shader& shader, Shader& instancedShader)
+{
+	m_instancedShaders.push_back({ &shader, &instancedShader });
+}
+
+Shader* RenderQueue::FindInstancedShader(const Shader* shader) const
+{
+	for (const auto& [plain, instanced] : m_instancedShaders)
+		if (plain == shader)
+			return instanced;
+	return nullptr;
+}
+
+uint64_t RenderQueue::MakeKey(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, uint32_t depth)
+{
+	return ((uint64_t)(pass & 0x3) << 62)
+		| ((uint64_t)(shader & 0xFF) << 54)
+		| ((uint64_t)(material & 0xFFFF) << 38)
+		| ((uint64_t)(mesh & 0xFFFF) << 22)
+		| (uint64_t)(depth & MAX_DEPTH);
+}
+
+unsigned int RenderQueue::ShaderSlot(unsigned int program)
+{
+	auto it = std::find(m_shaderPrograms.begin(), m_shaderPrograms.end(), program);
+	if (it != m_shaderPrograms.end())
+		return (unsigned int)(it - m_shaderPrograms.begin());
+	m_shaderPrograms.push_back(program);
+	return (unsigned int)m_shaderPrograms.size() - 1;
+}
+
+void RenderQueue::BeginFrame(const glm::vec3& cameraPosition)
+{
+	m_cameraPosition = cameraPosition;
+}
+
+void RenderQueue::Submit(Shader& shader, Mesh& mesh, int lod, const glm::mat4& modelMatrix, Pass pass)
+{
+	if (mesh.VAO == 0)
+		return;
+
+	float distance = glm::length(glm::vec3(modelMatrix * glm::vec4(mesh.boundsCenter, 1.0f)) - m_cameraPosition);
+	uint32_t depth = (uint32_t)(std::min(1.0f, std::log2(1.0f + distance) / std::log2(1.0f + DEPTH_RANGE)) * MAX_DEPTH);
+	if (pass == PASS_TRANSPARENT)
+		depth = MAX_DEPTH - depth;
+
+	uint64_t key = MakeKey(pass, ShaderSlot(shader.ID), mesh.material->id, mesh.VAO, depth);
+	m_order.push_back(SortEntry{ key, (uint32_t)m_packets.size() });
+	m_packets.push_back(DrawPacket{ &shader, &mesh, lod, modelMatrix, mesh.material });
+}
+
+void RenderQueue::BuildRuns()
+{
+	m_runs.clear();
+	m_instanceMatrices.clear();
+
+	for (size_t first = 0; first < m_order.size();)
+	{
+		const DrawPacket& packet = m_packets[m_order[first].packet];
+		Shader* instancedShader = m_instancing && (m_order[first].key >> 62) == PASS_OPAQUE ? FindInstancedShader(packet.shader) : nullptr;
+
+		// the sort already put packets of one mesh together, only the level can still differ within them
+		size_t end = first + 1;
+		while (instancedShader && end < m_order.size())
+		{
+			const DrawPacket& next = m_packets[m_order[end].packet];
+			if (next.shader != packet.shader || next.mesh != packet.mesh || next.lod != packet.lod)
+				break;
+			end++;
+		}
+
+		if (instancedShader && end - first >= MIN_INSTANCES)
+		{
+			m_runs.push_back(Run{ first, end - first, instancedShader, m_instanceMatrices.size() });
+			for (size_t i = first; i < end; i++)
+				m_instanceMatrices.push_back(m_packets[m_order[i].packet].modelMatrix);
+		}
+		else
+		{
+			for (size_t i = first; i < end; i++)
+				m_runs.push_back(Run{ i, 1, nullptr, 0 });
+		}
+		first = end;
+	}
+}
+
+void RenderQueue::Flush()
+{
+	m_lastPacketCount = m_packets.size();
+	m_lastInstancedCount = 0;
+	if (m_packets.empty())
+		return;
+
+	std::sort(m_order.begin(), m_order.end(), [](const SortEntry& a, const SortEntry& b) { return a.key < b.key; });
+	BuildRuns();
+
+	// every instanced run of the flush shares one range of the StreamBuffer, without room for it everything is drawn one by one
+	if (!m_instanceMatrices.empty())
+	{
+		if (StreamBuffer::Write(m_instanceMatrices.data(), m_instanceMatrices.size() * sizeof(glm::mat4), sizeof(glm::vec4), m_instanceOffset))
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, StreamBuffer::GetBuffer());
+		}
+		else
+		{
+			bool instancing = m_instancing;
+			m_instancing = false;
+			BuildRuns();
+			m_instancing = instancing;
+		}
+	}
+
+	// whatever was bound before the flush is unknown to the cache
+	m_state.Invalidate();
+	const Shader* lastShader = nullptr;
+	const Material* lastMaterial = nullptr;
+	GLint modelLocation = -1;
+	for (const Run& run : m_runs)
+	{
+		const DrawPacket& packet = m_packets[m_order[run.first].packet];
+		Shader* shader = run.instancedShader ? run.instancedShader : packet.shader;
+		m_state.UseProgram(shader->ID);
+		if (shader != lastShader)
+		{
+			lastShader = shader;
+			lastMaterial = nullptr;
+			modelLocation = shader->uniform("model");
+		}
+		if (packet.material != lastMaterial)
+		{
+			if (!lastMaterial || packet.material->useEmissive != lastMaterial->useEmissive)
+				shader->setBool(shader->useEmissiveLocation, packet.material->useEmissive);
+			for (int slot = 0; slot < Material::SLOT_COUNT; slot++)
+				m_state.BindTexture(Material::FIRST_UNIT + slot, packet.material->textures[slot]);
+			lastMaterial = packet.material;
+		}
+
+		m_state.BindVertexArray(packet.mesh->VAO);
+		if (run.instancedShader)
+		{
+			// GL 3.3 has no base instance, so the run's offset goes into the attribute pointers of the bound VAO
+			packet.mesh->PointInstanceAttributes(m_instanceOffset + run.firstInstance * sizeof(glm::mat4), sizeof(glm::mat4));
+			packet.mesh->DrawElements(packet.lod, (unsigned int)run.count);
+			m_lastInstancedCount += run.count;
+		}
+		else
+		{
+			shader->setMat4(modelLocation, packet.modelMatrix);
+			packet.mesh->DrawElements(packet.lod);
+		}
+	}
+
+	// leave GL the way the rest of the frame expects it
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	m_packets.clear();
+	m_order.clear();
+}
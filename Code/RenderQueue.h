@@ -0,0 +1,126 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/shader_m.h>
+#include <learnopengl/mesh.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Remembers the program, VAO and 2D textures last bound through it so binding the same thing again costs nothing.
+// Code outside the queue binds straight through GL, so the cache is only trusted between Invalidate and the end of a flush
+class GLStateCache
+{
+public:
+	static const int TEXTURE_UNITS = 16;
+
+	void Invalidate();
+
+	void UseProgram(unsigned int program);
+	void BindVertexArray(unsigned int vao);
+	void BindTexture(unsigned int unit, unsigned int texture);
+
+	// calls that reached GL and calls skipped because the state was already set, since the last ResetCounters
+	unsigned int programChanges = 0;
+	unsigned int vaoChanges = 0;
+	unsigned int textureChanges = 0;
+	unsigned int skipped = 0;
+	void ResetCounters();
+
+private:
+	static const unsigned int UNKNOWN = ~0u;
+
+	unsigned int m_program = UNKNOWN;
+	unsigned int m_vao = UNKNOWN;
+	unsigned int m_activeUnit = UNKNOWN;
+	unsigned int m_textures[TEXTURE_UNITS];
+};
+
+// Draws submitted during a frame are collected as packets with a 64-bit key and drawn in key order by Flush:
+//
+//   63-62 pass | 61-54 shader | 53-38 material id | 37-22 mesh | 21-0 depth
+//
+// so packets sharing a program, then textures, then a VAO end up next to each other and the GLStateCache
+// drops the repeated binds. Opaque packets go front to back within their state group, transparent ones back to front.
+//
+// Opaque runs of the same mesh and level under a shader with an instanced variant (SetInstancedShader) are drawn
+// with one glDrawElementsInstanced, their model matrices written to the StreamBuffer for per-instance attributes 7-10.
+class RenderQueue
+{
+public:
+	// fewer packets than this in a run are drawn one by one
+	static const size_t MIN_INSTANCES = 2;
+
+	// instancedShader draws the same thing as shader with the model matrix read from attributes 7-10
+	void SetInstancedShader(Shader& shader, Shader& instancedShader);
+	void SetInstancing(bool enabled) { m_instancing = enabled; }
+
+	enum Pass
+	{
+		PASS_OPAQUE = 0,
+		PASS_TRANSPARENT = 1,
+	};
+
+	// camera the depth bits are measured from, once per frame before the submits
+	void BeginFrame(const glm::vec3& cameraPosition);
+
+	// the mesh and shader must stay alive until Flush
+	void Submit(Shader& shader, Mesh& mesh, int lod, const glm::mat4& modelMatrix, Pass pass = PASS_OPAQUE);
+
+	// sorts and draws everything submitted since the last Flush, sets "model" per packet and binds materials only when they change
+	void Flush();
+
+	static uint64_t MakeKey(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, uint32_t depth);
+
+	size_t GetLastPacketCount() const { return m_lastPacketCount; }
+	// packets of the last Flush that went through an instanced draw
+	size_t GetLastInstancedCount() const { return m_lastInstancedCount; }
+	GLStateCache& GetState() { return m_state; }
+
+private:
+	struct DrawPacket
+	{
+		Shader* shader;
+		Mesh* mesh;
+		int lod;
+		glm::mat4 modelMatrix;
+		const Material* material;
+	};
+
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t packet;
+	};
+
+	// packets [first, first + count) of m_order, drawn instanced when instancedShader is set
+	struct Run
+	{
+		size_t first;
+		size_t count;
+		Shader* instancedShader;
+		size_t firstInstance;
+	};
+
+	// small dense index per program for the 8 shader bits
+	unsigned int ShaderSlot(unsigned int program);
+	Shader* FindInstancedShader(const Shader* shader) const;
+	void BuildRuns();
+
+	std::vector<DrawPacket> m_packets;
+	std::vector<SortEntry> m_order;
+	std::vector<unsigned int> m_shaderPrograms;
+	std::vector<std::pair<Shader*, Shader*>> m_instancedShaders;
+	glm::vec3 m_cameraPosition = glm::vec3(0.0f);
+	GLStateCache m_state;
+
+	bool m_instancing = true;
+	std::vector<Run> m_runs;
+	std::vector<glm::mat4> m_instanceMatrices;
+	size_t m_instanceOffset = 0;	// of this flush's matrices in the StreamBuffer
+
+	size_t m_lastPacketCount = 0;
+	size_t m_lastInstancedCount = 0;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+#include <iostream>
+
+// Per-frame counters gathered by the Renderer, printed once per second
+struct RenderStats
+{
+	unsigned int drawCalls = 0;
+	size_t triangles = 0;
+	size_t visible = 0;	// renderables passing the frustum test
+	size_t culled = 0;
+	size_t clustersVisible = 0;	// static level clusters passing the StaticBVH test
+	size_t clustersCulled = 0;
+	size_t occlusionTested = 0;	// renderables tested against the software depth buffer, and how many were hidden
+	size_t occluded = 0;
+	unsigned int skinnedInstances = 0;
+	unsigned int skinnedFallbacks = 0;	// skinned instances drawn one by one because the StreamBuffer was full, either pass
+	size_t queuedDraws = 0;	// static draws sorted by the RenderQueue, the GL binds its flush issued and the ones it skipped
+	size_t programChanges = 0;
+	size_t vaoChanges = 0;
+	size_t textureChanges = 0;
+	size_t redundantBinds = 0;
+	size_t staticInstances = 0;	// queued draws merged into instanced draws
+	size_t batchDraws = 0;	// multi-draws of the merged level batches, and the index ranges they covered
+	size_t batchRanges = 0;
+	size_t uniformCalls = 0;	// glUniform* calls through Shader, and the glGetUniformLocation lookups it still had to make
+	size_t uniformLookups = 0;
+	size_t streamedBytes = 0;	// written to the StreamBuffer, the frames that waited on its fences and the writes it refused when full (total, not averaged)
+	size_t streamStalls = 0;
+	size_t streamDrops = 0;
+	size_t shadowDraws = 0;	// draws of the shadow pass (part of drawCalls), and the times its static map was redrawn (total, not averaged)
+	size_t shadowStaticUpdates = 0;
+	size_t lights = 0;	// point/spot lights in the clusters' reach, light/cluster pairs, the fullest cluster (max, not averaged) and the CPU time of it all
+	size_t lightAssignments = 0;
+	size_t maxClusterLights = 0;
+	double lightMs = 0.0;
+	double submitMs = 0.0;
+
+	void Reset()
+	{
+		*this = RenderStats{};
+	}
+
+	void Print() const
+	{
+		std::cout << "\n[RenderStats] avg per frame | draws: " << drawCalls
+			<< " | triangles: " << triangles
+			<< " | visible: " << visible << " culled: " << culled
+			<< " | level clusters visible: " << clustersVisible << " culled: " << clustersCulled
+			<< " | occluded: " << (occlusionTested ? 100.0 * occluded / occlusionTested : 0.0) << "% (" << occluded << " of " << occlusionTested << ")"
+			<< " | skinned instances: " << skinnedInstances << " (uniform fallback " << skinnedFallbacks << ")"
+			<< " | queued: " << queuedDraws << " binds program/vao/texture: " << programChanges << "/" << vaoChanges << "/" << textureChanges
+			<< " (skipped " << redundantBinds << ") static instanced: " << staticInstances
+			<< " | level batches: " << batchDraws << " (" << batchRanges << " ranges)"
+			<< " | uniforms: " << uniformCalls << " (lookups " << uniformLookups << ")"
+			<< " | streamed: " << streamedBytes / 1024 << " KB (fence stalls " << streamStalls << ", dropped writes " << streamDrops << ")"
+			<< " | shadow draws: " << shadowDraws << " (static redraws " << shadowStaticUpdates << ")"
+			<< " | lights: " << lights << " in " << lightAssignments << " cluster slots (max " << maxClusterLights << ") " << lightMs << " ms"
+			<< " | submit: " << submitMs << " ms" << std::endl;
+	}
+};
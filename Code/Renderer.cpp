@@ -8,8 +8,23 @@
 
 #include "Application.h"
 #include "Camera.h"
+#include "TextureStreamer.h"
+#include "StreamBuffer.h"
+#include "JobSystem.h"
 
-const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
+#include <learnopengl/model.h>
+#include <learnopengl/model_animation.h>
+#include <learnopengl/cooked_ibl.h>
+
+#include <algorithm>
+#include <chrono>
+
+const int SHADOW_SIZE = 1024;
+// the light clusters start at the camera's near plane and end here, fragments further away get no local lights
+const float LIGHT_CLUSTER_NEAR = 0.1f;
+const float LIGHT_CLUSTER_FAR = 500.0f;
+// room for one frame of instance matrices, bone palettes and text in the StreamBuffer
+const size_t STREAM_FRAME_BYTES = 8 * 1024 * 1024;
 
 Camera Renderer::s_defaultCamera;
 
@@ -119,7 +134,10 @@ void renderQuad()
 Renderer::Renderer()
     //: m_baseShader("Assets/Shaders/lighting.vs", "Assets/Shaders/lighting.fs")
     : m_baseShader("Assets/Shaders/pbr.vs", "Assets/Shaders/pbr.fs")
-    , m_depthShader("Assets/Shaders/shadow_depth.vs", "Assets/Shaders/shadow_depth.fs")
+    , m_depthShader("Assets/Shaders/1.model_loading.vs", "Assets/Shaders/shadow_depth.fs")
+    , m_depthInstancedShader("Assets/Shaders/1.model_loading_instanced.vs", "Assets/Shaders/shadow_depth.fs")
+    , m_depthSkinnedShader("Assets/Shaders/anim_model.vs", "Assets/Shaders/shadow_depth.fs")
+    , m_depthSkinnedInstancedShader("Assets/Shaders/anim_model_instanced.vs", "Assets/Shaders/shadow_depth.fs")
     , m_pbrShader("Assets/Shaders/2.2.2.pbr.vs", "Assets/Shaders/2.2.2.pbr.fs")
     , m_equirectangularToCubemapShader("Assets/Shaders/2.2.2.cubemap.vs", "Assets/Shaders/2.2.2.equirectangular_to_cubemap.fs")
     , m_irradianceShader("Assets/Shaders/2.2.2.cubemap.vs", "Assets/Shaders/2.2.2.irradiance_convolution.fs")
@@ -127,12 +145,30 @@ Renderer::Renderer()
     , m_brdfShader("Assets/Shaders/2.2.2.brdf.vs", "Assets/Shaders/2.2.2.brdf.fs")
     , m_backgroundShader("Assets/Shaders/2.2.2.background.vs", "Assets/Shaders/2.2.2.background.fs")
     , m_animShader("Assets/Shaders/anim_model.vs", "Assets/Shaders/anim_model.fs")
+    , m_animInstancedShader("Assets/Shaders/anim_model_instanced.vs", "Assets/Shaders/anim_model.fs")
     , m_camera(&s_defaultCamera)
     , m_basicShader("Assets/Shaders/1.model_loading.vs", "Assets/Shaders/1.model_loading.fs")
+    , m_basicInstancedShader("Assets/Shaders/1.model_loading_instanced.vs", "Assets/Shaders/1.model_loading.fs")
 {
     SetupDepthMap();
     SetupPlane();
     SetupCube();
+    // the bone palettes are read through a texture buffer over the whole ring, so it must stay addressable as one
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    StreamBuffer::Init(std::min(STREAM_FRAME_BYTES, (size_t)maxTexels * sizeof(glm::vec4) / StreamBuffer::FRAMES));
+    m_skinnedBatch.Init();
+    m_lightClusters.Init();
+    m_queue.SetInstancedShader(m_basicShader, m_basicInstancedShader);
+    m_queue.SetInstancedShader(m_depthShader, m_depthInstancedShader);
+
+    m_frameUniforms.Init();
+    for (const Shader* shader : { &m_baseShader, &m_pbrShader, &m_backgroundShader, &m_animShader, &m_animInstancedShader, &m_basicShader, &m_basicInstancedShader,
+        &m_depthShader, &m_depthInstancedShader, &m_depthSkinnedShader, &m_depthSkinnedInstancedShader })
+        m_frameUniforms.Attach(*shader);
+    // material samplers are set once here instead of on every draw (the pbr shader gets its own in SetupPBR)
+    for (Shader* shader : { &m_baseShader, &m_animShader, &m_animInstancedShader, &m_basicShader, &m_basicInstancedShader })
+        Material::BindSamplers(*shader);
 
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
@@ -142,20 +178,96 @@ Renderer::Renderer()
 void Renderer::RecompileShaders()
 {
     m_pbrShader = Shader("Assets/Shaders/2.2.2.pbr.vs", "Assets/Shaders/2.2.2.pbr.fs");
+    m_frameUniforms.Attach(m_pbrShader);
     m_pbrShader.use();
     m_pbrShader.setInt("irradianceMap", 0);
     m_pbrShader.setInt("prefilterMap", 1);
     m_pbrShader.setInt("brdfLUT", 2);
-    m_pbrShader.setInt("albedoMap", 3);
-    m_pbrShader.setInt("normalMap", 4);
-    m_pbrShader.setInt("metallicMap", 5);
-    m_pbrShader.setInt("roughnessMap", 6);
-    m_pbrShader.setInt("aoMap", 7);
-    m_pbrShader.setInt("emissiveMap", 8);
+    Material::BindSamplers(m_pbrShader);
+}
+
+void Renderer::SubmitSkinned(Model_Bone* model, const glm::mat4& modelMatrix, const std::vector<glm::mat4>& boneMatrices, Lod::Selection& lod)
+{
+    if (!m_shadowPass)
+        TextureStreamer::Request(*model, modelMatrix);
+    int level = model->SelectLod(modelMatrix, lod);
+
+    if (m_skinnedInstancing)
+    {
+        m_skinnedBatch.Submit(model, modelMatrix, boneMatrices, level);
+        return;
+    }
+
+    SkinnedBatch::DrawUniform(m_shadowPass ? m_depthSkinnedShader : m_animShader, model, modelMatrix, boneMatrices.data(), (int)boneMatrices.size(), level);
+    if (!m_shadowPass)
+        m_stats.skinnedInstances++;
+}
+
+void Renderer::FlushSkinned()
+{
+    if (m_shadowPass)
+        m_skinnedBatch.Flush(m_depthSkinnedInstancedShader, m_depthSkinnedShader);
+    else
+        m_skinnedBatch.Flush(m_animInstancedShader, m_animShader);
+    if (!m_shadowPass)
+        m_stats.skinnedInstances += m_skinnedBatch.GetInstanceCount();
+    m_stats.skinnedFallbacks += m_skinnedBatch.GetFallbackCount();
+}
+
+void Renderer::BeginStatic(const glm::vec3& cameraPosition)
+{
+    m_queue.BeginFrame(cameraPosition);
+}
+
+void Renderer::SubmitStatic(Shader& shader, Model_Static& model, const glm::mat4& modelMatrix, Lod::Selection* lod, const std::vector<unsigned int>* meshIndices)
+{
+    // the shadow pass draws everything with the depth shader and needs no texture detail
+    if (!m_shadowPass)
+        TextureStreamer::Request(model, modelMatrix);
+    Shader& drawShader = m_shadowPass ? m_depthShader : shader;
+
+    auto submitMesh = [&](unsigned int i) {
+        m_queue.Submit(drawShader, model.meshes[i], lod ? model.SelectLod(i, modelMatrix, *lod) : 0, modelMatrix);
+    };
+    if (meshIndices) {
+        for (unsigned int i : *meshIndices)
+            submitMesh(i);
+    }
+    else {
+        for (unsigned int i = 0; i < model.meshes.size(); i++)
+            submitMesh(i);
+    }
+}
+
+void Renderer::FlushStatic()
+{
+    GLStateCache& state = m_queue.GetState();
+    state.ResetCounters();
+    m_queue.SetInstancing(m_staticInstancing);
+    m_queue.Flush();
+    if (m_shadowPass)
+        return;
+
+    m_stats.queuedDraws += m_queue.GetLastPacketCount();
+    m_stats.staticInstances += m_queue.GetLastInstancedCount();
+    m_stats.programChanges += state.programChanges;
+    m_stats.vaoChanges += state.vaoChanges;
+    m_stats.textureChanges += state.textureChanges;
+    m_stats.redundantBinds += state.skipped;
+}
+
+void Renderer::DrawStaticBatch(Shader& shader, StaticBatch& batch, Model_Static& model, const std::vector<unsigned int>& clusters, Lod::Selection& lod)
+{
+    TextureStreamer::Request(model, batch.GetModelMatrix());
+    batch.Draw(shader, clusters, lod);
+
+    m_stats.batchDraws += batch.GetLastDraws();
+    m_stats.batchRanges += batch.GetLastRanges();
 }
 
 Renderer::~Renderer()
 {
+    StreamBuffer::Shutdown();
     glDeleteVertexArrays(1, &m_planeVAO);
     glDeleteBuffers(1, &m_planeVBO);
 }
@@ -166,12 +278,7 @@ void Renderer::SetupPBR(const std::string& cubeMapPath)
     m_pbrShader.setInt("irradianceMap", 0);
     m_pbrShader.setInt("prefilterMap", 1);
     m_pbrShader.setInt("brdfLUT", 2);
-    m_pbrShader.setInt("albedoMap", 3);
-    m_pbrShader.setInt("normalMap", 4);
-    m_pbrShader.setInt("metallicMap", 5);
-    m_pbrShader.setInt("roughnessMap", 6);
-    m_pbrShader.setInt("aoMap", 7);
-    m_pbrShader.setInt("emissiveMap", 8);
+    Material::BindSamplers(m_pbrShader);
 
     m_backgroundShader.use();
     m_backgroundShader.setInt("environmentMap", 0);
@@ -183,6 +290,19 @@ void Renderer::SetupPBR(const std::string& cubeMapPath)
     glBindRenderbuffer(GL_RENDERBUFFER, m_captureRBO);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_captureRBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // the maps only depend on the HDR, a previous run may already have rendered them
+    auto start = std::chrono::high_resolution_clock::now();
+    uint64_t sourceHash = CookedIBL::SourceHash(cubeMapPath);
+    std::string cookedPath = CookedIBL::CookedPath(sourceHash);
+    if (CookedIBL::Read(cookedPath, sourceHash, m_envCubemap, m_irradianceMap, m_prefilterMap, m_brdfLUTTexture))
+    {
+        std::cout << "[IBL] maps loaded from " << cookedPath << " in "
+            << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms" << std::endl;
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, m_captureFBO);
 
     // pbr: load the HDR environment map
 // ---------------------------------
@@ -373,27 +493,16 @@ void Renderer::SetupPBR(const std::string& cubeMapPath)
     renderQuad();
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    bool saved = CookedIBL::s_enabled && CookedIBL::Write(cookedPath, sourceHash, m_envCubemap, m_irradianceMap, m_prefilterMap, m_brdfLUTTexture);
+    std::cout << "[IBL] maps precomputed in "
+        << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms"
+        << (saved ? ", saved to " + cookedPath : std::string()) << std::endl;
 }
 
 void Renderer::SetupDepthMap()
 {
-    glGenFramebuffers(1, &m_depthMapFBO);
-    // create depth texture
-    glGenTextures(1, &m_depthMap);
-    glBindTexture(GL_TEXTURE_2D, m_depthMap);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    // attach depth texture as FBO's depth buffer
-    glBindFramebuffer(GL_FRAMEBUFFER, m_depthMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthMap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    m_shadowCache.Init(SHADOW_SIZE);
 
     m_baseShader.use();
     m_baseShader.setInt("diffuseTexture", 0);
@@ -492,14 +601,80 @@ void Renderer::SetupCube()
     glBindVertexArray(0);
 }
 
-void Renderer::RenderDepthMap(const glm::mat4& lightSpaceMatrix)
+bool Renderer::BeginShadows(const glm::vec3& lightDirection, const glm::vec3& focusCenter, float focusRadius, const glm::vec3& sceneCenter, float sceneRadius)
+{
+    bool stale = m_shadowCache.Fit(lightDirection, focusCenter, focusRadius, sceneCenter, sceneRadius);
+
+    // every depth shader reads the light's box as its camera
+    m_shadowPass = true;
+    m_shadowDrawStart = Mesh::s_drawCalls;
+    m_frameUniforms.Update(m_shadowCache.GetView(), m_shadowCache.GetProjection(), m_shadowCache.GetLightPosition(), (float)m_lastFrameTime, m_frameDelta);
+    m_queue.BeginFrame(m_shadowCache.GetLightPosition());
+
+    if (stale)
+        m_shadowCache.BeginStatic();
+    return stale;
+}
+
+void Renderer::DrawStaticShadows(StaticBatch& batch, const std::vector<unsigned int>& clusters)
+{
+    batch.DrawDepth(m_depthShader, clusters);
+}
+
+void Renderer::BeginDynamicShadows()
+{
+    // whatever the static part queued goes into the static map first
+    FlushStatic();
+    m_shadowCache.BeginDynamic();
+    m_queue.BeginFrame(m_shadowCache.GetLightPosition());
+}
+
+void Renderer::EndShadows()
+{
+    FlushStatic();
+    FlushSkinned();
+    m_shadowCache.End();
+    m_shadowPass = false;
+
+    m_stats.shadowDraws += Mesh::s_drawCalls - m_shadowDrawStart;
+    m_stats.shadowStaticUpdates += m_shadowCache.m_staticUpdates;
+    m_shadowCache.m_staticUpdates = 0;
+
+    glm::vec2 windowSize = Application::Get().GetWindowSize();
+    glViewport(0, 0, windowSize.x, windowSize.y);
+    m_frameUniforms.Update(m_frameView, m_frameProjection, m_frameCameraPosition, (float)m_lastFrameTime, m_frameDelta);
+}
+
+void Renderer::UpdateLights()
 {
-    m_depthShader.use();
-    m_depthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+    m_lightClusters.Update(m_lights, m_frameView, m_frameProjection, LIGHT_CLUSTER_NEAR, LIGHT_CLUSTER_FAR, Application::Get().GetWindowSize());
+    m_lightClusters.Bind(m_pbrShader);
 
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_depthMapFBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
+    m_stats.lights += m_lightClusters.GetLightCount();
+    m_stats.lightAssignments += m_lightClusters.GetAssignmentCount();
+    m_stats.maxClusterLights = std::max(m_stats.maxClusterLights, (size_t)m_lightClusters.GetMaxPerCluster());
+    m_stats.lightMs += m_lightClusters.GetLastMs();
+}
+
+void Renderer::BenchmarkLights(int iterations)
+{
+    glm::vec2 windowSize = Application::Get().GetWindowSize();
+    double ms[2] = {};
+    for (int parallel = 0; parallel < 2; parallel++)
+    {
+        m_lightClusters.SetParallel(parallel != 0);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; i++)
+            m_lightClusters.Assign(m_lights, m_frameView, m_frameProjection, LIGHT_CLUSTER_NEAR, LIGHT_CLUSTER_FAR, windowSize);
+        ms[parallel] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+    }
+
+    // what a fragment loops over: its cluster's lights against every light without clustering
+    size_t lights = m_lightClusters.GetLightCount();
+    std::cout << "\n[Lights] " << m_lights.size() << " lights, " << lights << " in the clusters' reach: assignment "
+        << ms[0] << " ms on one thread, " << ms[1] << " ms on " << JobSystem::GetWorkerCount() + 1 << " threads | "
+        << (double)m_lightClusters.GetAssignmentCount() / LightClusters::CLUSTER_COUNT << " lights per cluster on average, "
+        << m_lightClusters.GetMaxPerCluster() << " at most, instead of " << lights << std::endl;
 }
 
 void Renderer::RenderLighting(const glm::vec3& lightPosition, const glm::mat4& lightSpaceMatrix)
@@ -509,8 +684,6 @@ void Renderer::RenderLighting(const glm::vec3& lightPosition, const glm::mat4& l
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
     m_baseShader.use();
-    m_baseShader.setMat4("viewProjection", m_camera->GetViewProjectionMatrix());
-    m_baseShader.setVec3("viewPosition", m_camera->GetPosition());
     m_baseShader.setVec3("lightPosition", lightPosition);
     m_baseShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
 
@@ -530,14 +703,13 @@ void Renderer::RenderLighting(const glm::vec3& lightPosition, const glm::mat4& l
     }
     
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, m_depthMap);
+    glBindTexture(GL_TEXTURE_2D, m_shadowCache.GetDepthMap());
 }
 
 void Renderer::RenderSkybox()
 {
     m_backgroundShader.use();
 
-    m_backgroundShader.setMat4("view", m_camera->GetViewMatrix());
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, m_envCubemap);
     renderCube();
@@ -556,6 +728,18 @@ void Renderer::DrawCube()
     glBindVertexArray(0);
 }
 
+void Renderer::UpdateFrameData(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition)
+{
+    double time = glfwGetTime();
+    float deltaTime = m_lastFrameTime > 0.0 ? (float)(time - m_lastFrameTime) : 0.0f;
+    m_lastFrameTime = time;
+    m_frameView = view;
+    m_frameProjection = projection;
+    m_frameCameraPosition = cameraPosition;
+    m_frameDelta = deltaTime;
+    m_frameUniforms.Update(view, projection, cameraPosition, (float)time, deltaTime);
+}
+
 void Renderer::Clear()
 {
     glm::vec2 windowSize = Application::Get().GetWindowSize();
@@ -570,13 +754,7 @@ void Renderer::BeginFrame(Camera& camera)
     Clear();
 
     m_camera = &camera;
-
-    m_pbrShader.use();
-    glm::mat4 model = glm::mat4(1.0f);
-    glm::mat4 view = camera.GetViewMatrix();
-    m_pbrShader.setMat4("view", view);
-    m_pbrShader.setVec3("camPos", camera.GetPosition());
-
+    UpdateFrameData(camera.GetViewMatrix(), camera.GetProjectionMatrix(), camera.GetPosition());
 
     // bind pre-computed IBL data
     glActiveTexture(GL_TEXTURE0);
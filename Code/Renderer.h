@@ -6,9 +6,20 @@
 #include <learnopengl/shader_m.h>
 #include "Camera.h"
 #include "Light.h"
+#include "SkinnedBatch.h"
+#include "RenderQueue.h"
+#include "StaticBatch.h"
+#include "ShadowCache.h"
+#include "LightClusters.h"
+#include "FrameUniforms.h"
+#include "RenderStats.h"
+
+#include <learnopengl/lod.h>
 
 #include <vector>
 
+class Model_Static;
+
 class Renderer
 {
 public:
@@ -20,17 +31,54 @@ public:
 	void Clear();
 	void BeginFrame(Camera& camera);
 
+	// uploads the FrameData block every camera space shader reads, once per frame before drawing
+	void UpdateFrameData(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition);
+
 	void DrawPlane();
 	void DrawCube();
 
-	void RenderDepthMap(const glm::mat4& lightSpaceMatrix);
+	// directional shadow map, see ShadowCache. BeginShadows fits the light's box around the focus sphere and returns true when
+	// the static casters have to be drawn again (DrawStaticShadows, or SubmitStatic + FlushStatic); BeginDynamicShadows then
+	// starts from the cached static depth, the Submit* calls up to EndShadows draw the moving casters depth only from the light
+	bool BeginShadows(const glm::vec3& lightDirection, const glm::vec3& focusCenter, float focusRadius, const glm::vec3& sceneCenter, float sceneRadius);
+	void DrawStaticShadows(StaticBatch& batch, const std::vector<unsigned int>& clusters);
+	void BeginDynamicShadows();
+	void EndShadows();
+	glm::mat4 GetShadowMatrix() const { return m_shadowCache.GetLightSpaceMatrix(); }
+	ShadowCache& GetShadowCache() { return m_shadowCache; }
+
+	// point and spot lights, assigned to the camera's clusters once per frame after UpdateFrameData (see LightClusters)
+	std::vector<Light>& GetLights() { return m_lights; }
+	void UpdateLights();
+	// times the CPU assignment of the current lights on one thread and on the JobSystem, and prints it
+	void BenchmarkLights(int iterations);
+
 	void RenderLighting(const glm::vec3& lightPosition, const glm::mat4& lightSpaceMatrix);
 	void RenderSkybox();
 
 	void RecompileShaders();
 
+	// skinned characters are batched per Model_Bone and drawn instanced in FlushSkinned,
+	// or drawn right away with m_animShader when instancing is off.
+	// lod keeps the detail level of this character between frames (see learnopengl/lod.h)
+	void SubmitSkinned(Model_Bone* model, const glm::mat4& modelMatrix, const std::vector<glm::mat4>& boneMatrices, Lod::Selection& lod);
+	void FlushSkinned();
+
+	// static meshes go through the sorted RenderQueue: BeginStatic with the camera position, SubmitStatic from the components,
+	// FlushStatic draws them in state order, repeated meshes instanced. lod and meshIndices are optional, without them every mesh is drawn at full detail
+	void BeginStatic(const glm::vec3& cameraPosition);
+	void SubmitStatic(Shader& shader, Model_Static& model, const glm::mat4& modelMatrix, Lod::Selection* lod = nullptr, const std::vector<unsigned int>* meshIndices = nullptr);
+	void FlushStatic();
+
+	// the level's merged world space batches, drawn right away, one multi-draw per material for the visible clusters
+	void DrawStaticBatch(Shader& shader, StaticBatch& batch, Model_Static& model, const std::vector<unsigned int>& clusters, Lod::Selection& lod);
+
 	Shader m_baseShader;
+	// depth only variants of the basic and skinned shaders for the shadow pass, the light's box is their FrameData camera
 	Shader m_depthShader;
+	Shader m_depthInstancedShader;
+	Shader m_depthSkinnedShader;
+	Shader m_depthSkinnedInstancedShader;
 	Shader m_pbrShader;
 	Shader m_equirectangularToCubemapShader;
 	Shader m_irradianceShader;
@@ -38,10 +86,9 @@ public:
 	Shader m_brdfShader;
 	Shader m_backgroundShader;
 	Shader m_animShader;
+	Shader m_animInstancedShader;
 	Shader m_basicShader;
-
-	unsigned int m_depthMapFBO;
-	unsigned int m_depthMap;
+	Shader m_basicInstancedShader;
 
 	unsigned int m_captureFBO;
 	unsigned int m_captureRBO;
@@ -57,6 +104,10 @@ public:
 	unsigned int m_brdfLUTTexture;
 	unsigned int m_envCubemap;
 
+	bool m_skinnedInstancing = true;
+	bool m_staticInstancing = true;
+	RenderStats m_stats;
+
 
 private:
 	void SetupDepthMap();
@@ -67,4 +118,20 @@ private:
 	static Camera s_defaultCamera;
 
 	std::vector<Light> m_lights;
+
+	SkinnedBatch m_skinnedBatch;
+	RenderQueue m_queue;
+	FrameUniforms m_frameUniforms;
+	double m_lastFrameTime = 0.0;
+
+	// the camera of the last UpdateFrameData, put back after the shadow pass borrowed FrameData
+	glm::mat4 m_frameView = glm::mat4(1.0f);
+	glm::mat4 m_frameProjection = glm::mat4(1.0f);
+	glm::vec3 m_frameCameraPosition = glm::vec3(0.0f);
+	float m_frameDelta = 0.0f;
+
+	ShadowCache m_shadowCache;
+	LightClusters m_lightClusters;
+	bool m_shadowPass = false;
+	unsigned int m_shadowDrawStart = 0;
 };
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "ShadowCache.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// the box never gets smaller than this, in world units
+	const float MIN_HALF_SIZE = 4.0f;
+	// depth beyond the level's bounds, room for moving casters above it
+	const float DEPTH_PADDING = 10.0f;
+}
+
+ShadowCache::~ShadowCache()
+{
+	glDeleteFramebuffers(1, &m_staticFBO);
+	glDeleteFramebuffers(1, &m_liveFBO);
+	glDeleteTextures(1, &m_staticDepth);
+	glDeleteTextures(1, &m_liveDepth);
+}
+
+unsigned int ShadowCache::CreateDepthTarget(int size, unsigned int& outTexture)
+{
+	glGenTextures(1, &outTexture);
+	glBindTexture(GL_TEXTURE_2D, outTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
+	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	unsigned int fbo;
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, outTexture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return fbo;
+}
+
+void ShadowCache::Init(int size)
+{
+	m_size = size;
+	m_staticFBO = CreateDepthTarget(size, m_staticDepth);
+	m_liveFBO = CreateDepthTarget(size, m_liveDepth);
+	m_valid = false;
+}
+
+bool ShadowCache::Fit(const glm::vec3& lightDirection, const glm::vec3& focusCenter, float focusRadius, const glm::vec3& sceneCenter, float sceneRadius)
+{
+	glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::mat4 rotation = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+
+	// the focus radius rounded up to a power of two, so the box keeps its size while the camera moves. The center snaps
+	// to a whole number of texels close to a quarter of that, the box is grown by one step so the sphere always fits
+	float half = std::exp2(std::ceil(std::log2(std::max(focusRadius, MIN_HALF_SIZE))));
+	float extent = half * 1.25f;
+	float texel = 2.0f * extent / m_size;
+	float step = std::max(1.0f, std::floor(half * 0.25f / texel)) * texel;
+
+	glm::vec3 focus = glm::vec3(rotation * glm::vec4(focusCenter, 1.0f));
+	float x = std::round(focus.x / step) * step;
+	float y = std::round(focus.y / step) * step;
+
+	// depth always spans the whole level, casters outside the focus still throw shadows into it
+	float sceneZ = (rotation * glm::vec4(sceneCenter, 1.0f)).z;
+	float depth = sceneRadius + DEPTH_PADDING;
+	glm::mat4 projection = glm::ortho(x - extent, x + extent, y - extent, y + extent, -(sceneZ + depth), -(sceneZ - depth));
+
+	bool stale = !m_caching || !m_valid || rotation != m_view || projection != m_projection;
+	m_view = rotation;
+	m_projection = projection;
+	m_lightPosition = glm::vec3(glm::inverse(rotation) * glm::vec4(x, y, sceneZ + depth, 1.0f));
+	if (stale)
+		m_valid = false;
+	return stale;
+}
+
+void ShadowCache::BeginStatic()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_staticFBO);
+	glViewport(0, 0, m_size, m_size);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	m_valid = true;
+	m_staticUpdates++;
+}
+
+void ShadowCache::BeginDynamic()
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_staticFBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_liveFBO);
+	glBlitFramebuffer(0, 0, m_size, m_size, 0, 0, m_size, m_size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_liveFBO);
+	glViewport(0, 0, m_size, m_size);
+}
+
+void ShadowCache::End()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowCache::FitCameraSphere(const glm::vec3& position, const glm::vec3& forward, float fovY, float aspect, float nearPlane, float distance, glm::vec3& outCenter, float& outRadius)
+{
+	// k is the slope from the view axis to the far corners
+	float tanHalf = std::tan(fovY * 0.5f);
+	float k2 = tanHalf * tanHalf * (1.0f + aspect * aspect);
+	float n = nearPlane, f = distance;
+
+	if (k2 >= (f - n) / (f + n))
+	{
+		// wide enough that the far rectangle alone decides the sphere
+		outCenter = position + forward * f;
+		outRadius = f * std::sqrt(k2);
+		return;
+	}
+	outCenter = position + forward * (0.5f * (f + n) * (1.0f + k2));
+	outRadius = 0.5f * std::sqrt((f - n) * (f - n) + 2.0f * (f * f + n * n) * k2 + (f + n) * (f + n) * k2 * k2);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Directional shadow map split into what never moves and what does. The static casters (the level) are drawn into
+// their own depth map only when it goes stale: the light's box moved, or Invalidate after the static geometry changed.
+// Every frame that map is copied into the live one and only the moving casters are drawn on top.
+//
+// The box is fitted around the sphere the camera sees shadows in, but snapped so it only moves in steps of a
+// quarter of its size, and its depth range spans the whole level, so walking around redraws the static map
+// every few metres instead of every frame.
+//
+// per frame: Fit, then BeginStatic + the static casters when it returned true, BeginDynamic + the moving casters, End
+class ShadowCache
+{
+public:
+	~ShadowCache();
+
+	void Init(int size);
+
+	// lightDirection points from the light into the scene; focus is the region shadows are seen in, scene the static casters'
+	// bounds. Returns true when the static map has to be redrawn this frame
+	bool Fit(const glm::vec3& lightDirection, const glm::vec3& focusCenter, float focusRadius, const glm::vec3& sceneCenter, float sceneRadius);
+	void Invalidate() { m_valid = false; }
+
+	// with caching off the static map is redrawn every frame, for comparison
+	void SetCaching(bool enabled) { m_caching = enabled; }
+
+	// binds the static map's framebuffer, cleared
+	void BeginStatic();
+	// copies the static map into the live one and binds that for the moving casters
+	void BeginDynamic();
+	// back to the default framebuffer, the viewport is left to the caller
+	void End();
+
+	const glm::mat4& GetView() const { return m_view; }
+	const glm::mat4& GetProjection() const { return m_projection; }
+	glm::mat4 GetLightSpaceMatrix() const { return m_projection * m_view; }
+	glm::vec3 GetLightPosition() const { return m_lightPosition; }
+
+	// the live depth map, what the lighting shaders sample
+	unsigned int GetDepthMap() const { return m_liveDepth; }
+	int GetSize() const { return m_size; }
+
+	// times the static map was redrawn since the counter was last reset (see RenderStats)
+	unsigned int m_staticUpdates = 0;
+
+	// smallest sphere around the part of a camera's view closer than distance
+	static void FitCameraSphere(const glm::vec3& position, const glm::vec3& forward, float fovY, float aspect, float nearPlane, float distance, glm::vec3& outCenter, float& outRadius);
+
+private:
+	static unsigned int CreateDepthTarget(int size, unsigned int& outTexture);
+
+	int m_size = 0;
+	unsigned int m_staticFBO = 0, m_staticDepth = 0;
+	unsigned int m_liveFBO = 0, m_liveDepth = 0;
+
+	glm::mat4 m_view = glm::mat4(1.0f);
+	glm::mat4 m_projection = glm::mat4(1.0f);
+	glm::vec3 m_lightPosition = glm::vec3(0.0f);
+	bool m_valid = false;
+	bool m_caching = true;
+};
@@ -0,0 +1,135 @@
+#include "SkinnedBatch.h"
+#include "StreamBuffer.h"
+
+#include <learnopengl/model_animation.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+// texture unit of the bone palette, 0-8 are taken by the PBR maps of Mesh
+static const int PALETTE_TEXTURE_UNIT = 9;
+// size of finalBonesMatrices in anim_model.vs
+static const int MAX_UNIFORM_BONES = 100;
+static_assert(offsetof(SkinnedInstance, boneOffset) == sizeof(glm::mat4), "Mesh::PointInstanceAttributes reads boneOffset right after the matrix");
+
+SkinnedBatch::~SkinnedBatch()
+{
+	glDeleteTextures(1, &m_paletteTexture);
+}
+
+void SkinnedBatch::Init()
+{
+	// the palette texture looks at the whole StreamBuffer, instances find their chunk's palette through boneOffset
+	glGenTextures(1, &m_paletteTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, m_paletteTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, StreamBuffer::GetBuffer());
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &m_maxPaletteTexels);
+}
+
+void SkinnedBatch::Submit(Model_Bone* model, const glm::mat4& modelMatrix, const std::vector<glm::mat4>& boneMatrices, int lod)
+{
+	GroupKey key(model, lod);
+	Group& group = m_groups[key];
+	if (group.instances.empty())
+	{
+		// first instance of this model and level in the frame
+		m_order.push_back(key);
+		group.boneCount = std::max(1, std::min(model->GetBoneCount(), (int)boneMatrices.size()));
+	}
+
+	SkinnedInstance instance;
+	instance.model = modelMatrix;
+	instance.boneOffset = (int)group.instances.size() * group.boneCount;
+	group.instances.push_back(instance);
+
+	// every instance takes boneCount slots, a shorter (or empty) palette is padded with the bind pose
+	int copied = std::min(group.boneCount, (int)boneMatrices.size());
+	group.palette.insert(group.palette.end(), boneMatrices.begin(), boneMatrices.begin() + copied);
+	group.palette.resize(group.palette.size() + (group.boneCount - copied), glm::mat4(1.0f));
+}
+
+void SkinnedBatch::DrawUniform(Shader& shader, Model_Bone* model, const glm::mat4& modelMatrix, const glm::mat4* boneMatrices, int boneCount, int lod)
+{
+	shader.use();
+	if (boneCount > 0)
+		shader.setMat4Array(shader.uniform("finalBonesMatrices[0]"), boneMatrices, std::min(boneCount, MAX_UNIFORM_BONES));
+
+	shader.setMat4("model", modelMatrix);
+	model->Draw(shader, lod);
+}
+
+void SkinnedBatch::Flush(Shader& shader, Shader& fallbackShader)
+{
+	m_instanceCount = 0;
+	m_fallbackCount = 0;
+	if (m_order.empty())
+		return;
+
+	shader.use();
+	shader.setInt("bonePalette", PALETTE_TEXTURE_UNIT);
+	glActiveTexture(GL_TEXTURE0 + PALETTE_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_paletteTexture);
+	glBindBuffer(GL_ARRAY_BUFFER, StreamBuffer::GetBuffer());
+
+	for (const GroupKey& key : m_order)
+	{
+		Model_Bone* model = key.first;
+		Group& group = m_groups[key];
+		shader.setInt("boneCount", group.boneCount);
+
+		// keep every chunk inside GL_MAX_TEXTURE_BUFFER_SIZE (4 texels per matrix) and half a frame of the StreamBuffer
+		size_t instanceBytes = (size_t)group.boneCount * sizeof(glm::mat4) + sizeof(SkinnedInstance);
+		int maxPerChunk = std::max(1, std::min(m_maxPaletteTexels / (group.boneCount * 4), (int)(StreamBuffer::GetFrameBytes() / 2 / instanceBytes)));
+		int total = (int)group.instances.size();
+
+		int first = 0;
+		for (; first < total; first += maxPerChunk)
+		{
+			int count = std::min(maxPerChunk, total - first);
+
+			size_t paletteOffset, instanceOffset;
+			if (!StreamBuffer::Write(&group.palette[(size_t)first * group.boneCount], (size_t)count * group.boneCount * sizeof(glm::mat4), sizeof(glm::mat4), paletteOffset))
+				break;
+
+			// rebase the palette offsets onto where this chunk's palette landed in the buffer
+			int paletteBase = (int)(paletteOffset / sizeof(glm::mat4)) - first * group.boneCount;
+			std::vector<SkinnedInstance> chunk(group.instances.begin() + first, group.instances.begin() + first + count);
+			for (SkinnedInstance& instance : chunk)
+				instance.boneOffset += paletteBase;
+
+			if (!StreamBuffer::Write(chunk.data(), chunk.size() * sizeof(SkinnedInstance), sizeof(glm::vec4), instanceOffset))
+				break;
+
+			shader.use();
+			for (Mesh& mesh : model->meshes)
+			{
+				// the instances move around the StreamBuffer every chunk
+				glBindVertexArray(mesh.VAO);
+				mesh.PointInstanceAttributes(instanceOffset, sizeof(SkinnedInstance), true);
+				glBindVertexArray(0);
+				mesh.DrawInstanced(shader, count, key.second);
+			}
+		}
+
+		// the ring is full for this frame: the rest still get drawn, just one uniform upload each
+		for (int i = first; i < total; i++)
+			DrawUniform(fallbackShader, model, group.instances[i].model, &group.palette[(size_t)i * group.boneCount], group.boneCount, key.second);
+		m_fallbackCount += total - first;
+
+		m_instanceCount += total;
+		group.instances.clear();
+		group.palette.clear();
+	}
+	m_order.clear();
+
+	if (m_fallbackCount > 0)
+		std::cout << "[SkinnedBatch] StreamBuffer full, " << m_fallbackCount << " instances drawn without instancing this frame" << std::endl;
+
+	glActiveTexture(GL_TEXTURE0 + PALETTE_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
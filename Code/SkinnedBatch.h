@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/shader_m.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+class Model_Bone;
+
+// Per-instance vertex attributes (locations 7-11) read by anim_model_instanced.vs
+struct SkinnedInstance
+{
+	glm::mat4 model;
+	int boneOffset;
+};
+
+// Collects every skinned character submitted during a frame and draws all instances
+// of the same Model_Bone and detail level with one glDrawElementsInstanced per submesh.
+// Bone palettes and instance attributes of all instances are written to the StreamBuffer, the palettes read through one texture buffer over it.
+class SkinnedBatch
+{
+public:
+	~SkinnedBatch();
+
+	void Init();
+	void Submit(Model_Bone* model, const glm::mat4& modelMatrix, const std::vector<glm::mat4>& boneMatrices, int lod = 0);
+	// instances the StreamBuffer has no room for are drawn one by one with fallbackShader instead
+	void Flush(Shader& shader, Shader& fallbackShader);
+
+	// one instance through the finalBonesMatrices uniforms of anim_model.vs, the path without instancing
+	static void DrawUniform(Shader& shader, Model_Bone* model, const glm::mat4& modelMatrix, const glm::mat4* boneMatrices, int boneCount, int lod);
+
+	// of the last Flush: all instances drawn, and how many of them had to take the uniform path
+	unsigned int GetInstanceCount() const { return m_instanceCount; }
+	unsigned int GetFallbackCount() const { return m_fallbackCount; }
+
+private:
+	struct Group
+	{
+		std::vector<SkinnedInstance> instances;
+		std::vector<glm::mat4> palette;
+		int boneCount = 0;
+	};
+
+	// one group per model and LOD level
+	typedef std::pair<Model_Bone*, int> GroupKey;
+	std::vector<GroupKey> m_order;
+	std::map<GroupKey, Group> m_groups;
+
+	unsigned int m_paletteTexture = 0;
+	int m_maxPaletteTexels = 0;
+	unsigned int m_instanceCount = 0;
+	unsigned int m_fallbackCount = 0;
+};
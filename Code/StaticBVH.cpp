@@ -0,0 +1,134 @@
+#include "StaticBVH.h"
+
+#include <learnopengl/model.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+	// clusters per leaf, the last level is cheaper to test one by one than to split further
+	const uint32_t LEAF_SIZE = 2;
+}
+
+void StaticBVH::Build(const Model_Static& model, const glm::mat4& modelMatrix)
+{
+	m_nodes.clear();
+	m_items.clear();
+	m_itemMin.resize(model.meshes.size());
+	m_itemMax.resize(model.meshes.size());
+
+	for (unsigned int i = 0; i < model.meshes.size(); i++)
+	{
+		glm::vec3 center, extents;
+		transformAABB(modelMatrix, model.meshes[i].boundsMin, model.meshes[i].boundsMax, center, extents);
+		m_itemMin[i] = center - extents;
+		m_itemMax[i] = center + extents;
+		m_items.push_back(i);
+	}
+
+	if (!m_items.empty())
+	{
+		m_nodes.reserve(m_items.size() * 2);
+		BuildNode(0, (uint32_t)m_items.size());
+	}
+
+	std::cout << "[StaticBVH] " << m_items.size() << " clusters, " << m_nodes.size() << " nodes" << std::endl;
+}
+
+uint32_t StaticBVH::BuildNode(uint32_t firstItem, uint32_t itemCount)
+{
+	glm::vec3 minBounds = m_itemMin[m_items[firstItem]], maxBounds = m_itemMax[m_items[firstItem]];
+	glm::vec3 minCenter = (minBounds + maxBounds) * 0.5f, maxCenter = minCenter;
+	for (uint32_t i = firstItem; i < firstItem + itemCount; i++)
+	{
+		unsigned int item = m_items[i];
+		minBounds = glm::min(minBounds, m_itemMin[item]);
+		maxBounds = glm::max(maxBounds, m_itemMax[item]);
+		glm::vec3 center = (m_itemMin[item] + m_itemMax[item]) * 0.5f;
+		minCenter = glm::min(minCenter, center);
+		maxCenter = glm::max(maxCenter, center);
+	}
+
+	uint32_t index = (uint32_t)m_nodes.size();
+	m_nodes.push_back(Node{ (minBounds + maxBounds) * 0.5f, firstItem, (maxBounds - minBounds) * 0.5f, itemCount, 0 });
+	if (itemCount <= LEAF_SIZE)
+		return index;
+
+	// median split on the longest axis of the cluster centers
+	glm::vec3 size = maxCenter - minCenter;
+	int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+	uint32_t half = itemCount / 2;
+	std::nth_element(m_items.begin() + firstItem, m_items.begin() + firstItem + half, m_items.begin() + firstItem + itemCount,
+		[&](unsigned int a, unsigned int b) { return m_itemMin[a][axis] + m_itemMax[a][axis] < m_itemMin[b][axis] + m_itemMax[b][axis]; });
+
+	BuildNode(firstItem, half);
+	uint32_t right = BuildNode(firstItem + half, itemCount - half);
+	m_nodes[index].rightChild = right;
+	return index;
+}
+
+void StaticBVH::Cull(const Frustum& frustum, std::vector<unsigned int>& visibleMeshes) const
+{
+	visibleMeshes.clear();
+	m_lastTests = 0;
+	if (m_nodes.empty())
+		return;
+
+	const Plane* const planes[6] = { &frustum.leftFace, &frustum.rightFace, &frustum.nearFace, &frustum.farFace, &frustum.topFace, &frustum.bottomFace };
+	CullNode(0, planes, 0x3F, visibleMeshes);
+}
+
+void StaticBVH::CullNode(uint32_t index, const Plane* const planes[6], unsigned int planeMask, std::vector<unsigned int>& visibleMeshes) const
+{
+	const Node& node = m_nodes[index];
+
+	// a plane the node is fully in front of is left out for the whole subtree
+	for (int p = 0; p < 6; p++)
+	{
+		if (!(planeMask & (1u << p)))
+			continue;
+
+		m_lastTests++;
+		const Plane& plane = *planes[p];
+		float signedDistance = plane.getSignedDistanceToPlane(node.center);
+		float reach = std::abs(plane.normal.x) * node.extents.x + std::abs(plane.normal.y) * node.extents.y + std::abs(plane.normal.z) * node.extents.z;
+		if (signedDistance + reach < 0.0f)
+			return;
+		if (signedDistance - reach >= 0.0f)
+			planeMask &= ~(1u << p);
+	}
+
+	if (planeMask == 0)
+	{
+		visibleMeshes.insert(visibleMeshes.end(), m_items.begin() + node.firstItem, m_items.begin() + node.firstItem + node.itemCount);
+		return;
+	}
+
+	if (node.rightChild == 0)
+	{
+		for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+		{
+			unsigned int item = m_items[i];
+			glm::vec3 center = (m_itemMin[item] + m_itemMax[item]) * 0.5f, extents = (m_itemMax[item] - m_itemMin[item]) * 0.5f;
+			bool visible = true;
+			for (int p = 0; p < 6 && visible; p++)
+			{
+				if (!(planeMask & (1u << p)))
+					continue;
+
+				m_lastTests++;
+				const Plane& plane = *planes[p];
+				float reach = std::abs(plane.normal.x) * extents.x + std::abs(plane.normal.y) * extents.y + std::abs(plane.normal.z) * extents.z;
+				visible = plane.getSignedDistanceToPlane(center) + reach >= 0.0f;
+			}
+			if (visible)
+				visibleMeshes.push_back(item);
+		}
+		return;
+	}
+
+	CullNode(index + 1, planes, planeMask, visibleMeshes);
+	CullNode(node.rightChild, planes, planeMask, visibleMeshes);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <learnopengl/frustum.h>
+
+#include <cstdint>
+#include <vector>
+
+class Model_Static;
+
+// Bounding volume hierarchy over the meshes (clusters, see learnopengl/mesh_cluster.h) of a static level model.
+// Built once when the model is loaded; Cull walks it top down against any frustum, the camera's or a light's,
+// dropping whole subtrees outside a plane and skipping the plane tests below nodes fully inside.
+class StaticBVH
+{
+public:
+	void Build(const Model_Static& model, const glm::mat4& modelMatrix);
+	bool IsBuilt() const { return !m_nodes.empty(); }
+
+	// indices into model.meshes of every cluster touching the frustum, in tree order (nearby clusters together)
+	void Cull(const Frustum& frustum, std::vector<unsigned int>& visibleMeshes) const;
+
+	size_t GetClusterCount() const { return m_items.size(); }
+	// node and plane tests done by the last Cull, for the stats
+	size_t GetLastTests() const { return m_lastTests; }
+
+private:
+	struct Node
+	{
+		glm::vec3 center;
+		uint32_t firstItem;	// subtree items are contiguous in m_items
+		glm::vec3 extents;
+		uint32_t itemCount;
+		uint32_t rightChild;	// 0 for leaves, the left child always follows its parent
+	};
+
+	uint32_t BuildNode(uint32_t firstItem, uint32_t itemCount);
+	void CullNode(uint32_t node, const Plane* const planes[6], unsigned int planeMask, std::vector<unsigned int>& visibleMeshes) const;
+
+	std::vector<Node> m_nodes;
+	std::vector<unsigned int> m_items;	// mesh indices
+	std::vector<glm::vec3> m_itemMin, m_itemMax;	// world boxes, by mesh index
+	mutable size_t m_lastTests = 0;
+};
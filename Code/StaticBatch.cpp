@@ -0,0 +1,220 @@
+#include "StaticBatch.h"
+
+#include <learnopengl/model.h>
+
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+namespace
+{
+	const uint32_t NO_BATCH = ~0u;
+}
+
+StaticBatch::~StaticBatch()
+{
+	Release();
+}
+
+void StaticBatch::Release()
+{
+	for (Batch& batch : m_batches)
+	{
+		glDeleteVertexArrays(1, &batch.VAO);
+		glDeleteBuffers(1, &batch.VBO);
+		glDeleteBuffers(1, &batch.EBO);
+	}
+	m_batches.clear();
+	m_clusters.clear();
+	m_built = false;
+}
+
+void StaticBatch::Build(const Model_Static& model, const glm::mat4& modelMatrix)
+{
+	Release();
+	m_modelMatrix = modelMatrix;
+	m_clusters.resize(model.meshes.size());
+
+	// one batch per material, in the order the materials first show up
+	std::unordered_map<const Material*, uint32_t> batchOf;
+	std::vector<std::vector<unsigned int>> members;
+	for (unsigned int i = 0; i < model.meshes.size(); i++)
+	{
+		const Mesh& mesh = model.meshes[i];
+		Cluster& cluster = m_clusters[i];
+		cluster.batch = NO_BATCH;
+		if (mesh.VAO == 0 || mesh.skinned || !mesh.material)
+			continue;
+
+		auto it = batchOf.find(mesh.material);
+		if (it == batchOf.end())
+		{
+			it = batchOf.emplace(mesh.material, (uint32_t)m_batches.size()).first;
+			m_batches.emplace_back();
+			m_batches.back().material = mesh.material;
+			members.emplace_back();
+		}
+		cluster.batch = it->second;
+		cluster.lodCount = std::min(mesh.GetLodCount(), Mesh::MAX_LODS);
+		Lod::TransformSphere(modelMatrix, mesh.boundsCenter, mesh.boundsRadius, cluster.center, cluster.radius);
+		members[it->second].push_back(i);
+	}
+
+	glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
+	std::vector<uint8_t> meshVertices;
+	std::vector<unsigned int> meshIndices;
+	size_t totalBytes = 0;
+	for (size_t b = 0; b < m_batches.size(); b++)
+	{
+		std::vector<PackedStaticVertex> vertices;
+		std::vector<std::vector<unsigned int>> clusterIndices(members[b].size());
+		std::vector<unsigned int> baseVertex(members[b].size());
+		for (size_t m = 0; m < members[b].size(); m++)
+		{
+			const Mesh& mesh = model.meshes[members[b][m]];
+			mesh.ReadBack(meshVertices, meshIndices);
+
+			baseVertex[m] = (unsigned int)vertices.size();
+			const PackedStaticVertex* packed = reinterpret_cast<const PackedStaticVertex*>(meshVertices.data());
+			for (unsigned int v = 0; v < mesh.vertexCount; v++)
+				vertices.push_back(PackedVertex::TransformStatic(packed[v], modelMatrix, normalMatrix));
+			clusterIndices[m].swap(meshIndices);
+		}
+
+		// level by level, so the same level of neighbouring clusters is contiguous
+		std::vector<unsigned int> indices;
+		for (int level = 0; level < Mesh::MAX_LODS; level++)
+		{
+			for (size_t m = 0; m < members[b].size(); m++)
+			{
+				const Mesh& mesh = model.meshes[members[b][m]];
+				Cluster& cluster = m_clusters[members[b][m]];
+				if (level >= cluster.lodCount)
+					continue;
+
+				Mesh::LodRange source = mesh.GetLod(level);
+				cluster.lods[level] = Mesh::LodRange{ (unsigned int)indices.size(), source.indexCount };
+				for (unsigned int k = 0; k < source.indexCount; k++)
+					indices.push_back(clusterIndices[m][source.firstIndex + k] + baseVertex[m]);
+			}
+		}
+
+		Batch& batch = m_batches[b];
+		glGenVertexArrays(1, &batch.VAO);
+		glGenBuffers(1, &batch.VBO);
+		glGenBuffers(1, &batch.EBO);
+		glBindVertexArray(batch.VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, batch.VBO);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PackedStaticVertex), vertices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+		PackedVertex::SetupAttributes(false);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		totalBytes += vertices.size() * sizeof(PackedStaticVertex) + indices.size() * sizeof(unsigned int);
+	}
+
+	m_built = true;
+	std::cout << "[StaticBatch] " << model.meshes.size() << " clusters merged into " << m_batches.size() << " material batches, "
+		<< totalBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+}
+
+void StaticBatch::Draw(Shader& shader, const std::vector<unsigned int>& clusters, Lod::Selection& lod)
+{
+	m_lastDraws = 0;
+	m_lastRanges = 0;
+	if (!m_built)
+		return;
+
+	for (Batch& batch : m_batches)
+		batch.visible.clear();
+	for (unsigned int i : clusters)
+	{
+		if (i >= m_clusters.size() || m_clusters[i].batch == NO_BATCH)
+			continue;
+		const Cluster& cluster = m_clusters[i];
+		int level = std::min(lod.Update(i, Lod::ScreenSize(cluster.center, cluster.radius), cluster.lodCount), cluster.lodCount - 1);
+		m_batches[cluster.batch].visible.push_back(cluster.lods[level]);
+	}
+
+	shader.use();
+	shader.setMat4("model", glm::mat4(1.0f));
+	for (Batch& batch : m_batches)
+	{
+		if (batch.visible.empty())
+			continue;
+		size_t indexTotal = CoalesceVisible(batch);
+
+		batch.material->Bind(shader);
+		glBindVertexArray(batch.VAO);
+		glMultiDrawElements(GL_TRIANGLES, batch.counts.data(), GL_UNSIGNED_INT, batch.offsets.data(), (GLsizei)batch.counts.size());
+
+		Mesh::s_drawCalls++;
+		Mesh::s_triangles += indexTotal / 3;
+		m_lastDraws++;
+		m_lastRanges += batch.counts.size();
+	}
+
+	glBindVertexArray(0);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void StaticBatch::DrawDepth(Shader& shader, const std::vector<unsigned int>& clusters)
+{
+	m_lastDraws = 0;
+	m_lastRanges = 0;
+	if (!m_built)
+		return;
+
+	for (Batch& batch : m_batches)
+		batch.visible.clear();
+	for (unsigned int i : clusters)
+	{
+		if (i < m_clusters.size() && m_clusters[i].batch != NO_BATCH)
+			m_batches[m_clusters[i].batch].visible.push_back(m_clusters[i].lods[0]);
+	}
+
+	shader.use();
+	shader.setMat4("model", glm::mat4(1.0f));
+	for (Batch& batch : m_batches)
+	{
+		if (batch.visible.empty())
+			continue;
+		size_t indexTotal = CoalesceVisible(batch);
+
+		glBindVertexArray(batch.VAO);
+		glMultiDrawElements(GL_TRIANGLES, batch.counts.data(), GL_UNSIGNED_INT, batch.offsets.data(), (GLsizei)batch.counts.size());
+
+		Mesh::s_drawCalls++;
+		Mesh::s_triangles += indexTotal / 3;
+		m_lastDraws++;
+		m_lastRanges += batch.counts.size();
+	}
+
+	glBindVertexArray(0);
+}
+
+size_t StaticBatch::CoalesceVisible(Batch& batch)
+{
+	// ranges that touch in the index buffer become one
+	std::sort(batch.visible.begin(), batch.visible.end(), [](const Mesh::LodRange& a, const Mesh::LodRange& b) { return a.firstIndex < b.firstIndex; });
+	batch.counts.clear();
+	batch.offsets.clear();
+	unsigned int first = batch.visible[0].firstIndex, end = first;
+	size_t indexTotal = 0;
+	for (const Mesh::LodRange& range : batch.visible)
+	{
+		if (range.firstIndex != end)
+		{
+			batch.counts.push_back((GLsizei)(end - first));
+			batch.offsets.push_back((const void*)(first * sizeof(unsigned int)));
+			first = range.firstIndex;
+		}
+		end = range.firstIndex + range.indexCount;
+		indexTotal += range.indexCount;
+	}
+	batch.counts.push_back((GLsizei)(end - first));
+	batch.offsets.push_back((const void*)(first * sizeof(unsigned int)));
+	return indexTotal;
+}
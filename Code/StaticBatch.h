@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/shader_m.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/lod.h>
+
+#include <cstdint>
+#include <vector>
+
+class Model_Static;
+
+// The clusters of a static level model pre-transformed to world space and merged per material into one shared
+// vertex/index buffer each, so drawing the level is one VAO bind and one glMultiDrawElements per material
+// instead of a bind and a draw per cluster.
+//
+// Every cluster keeps its index range per detail level, so the StaticBVH cull and the LOD selection still work
+// cluster by cluster. Within a batch the ranges are stored level by level in cluster order (nearby clusters
+// together, see mesh_cluster.h), so visible neighbours at the same level merge into one range.
+class StaticBatch
+{
+public:
+	~StaticBatch();
+
+	// reads the uploaded meshes back from GL once, load time only
+	void Build(const Model_Static& model, const glm::mat4& modelMatrix);
+	bool IsBuilt() const { return m_built; }
+
+	// draws the clusters (indices into model.meshes) with shader, "model" is set to identity.
+	// lod keeps each cluster's level between frames like Model_Static::SelectLod
+	void Draw(Shader& shader, const std::vector<unsigned int>& clusters, Lod::Selection& lod);
+	// the same at full detail without binding any material, for depth only passes like the shadow map
+	void DrawDepth(Shader& shader, const std::vector<unsigned int>& clusters);
+
+	const glm::mat4& GetModelMatrix() const { return m_modelMatrix; }
+	size_t GetBatchCount() const { return m_batches.size(); }
+	// glMultiDrawElements calls and the index ranges they drew in the last Draw, for the stats
+	size_t GetLastDraws() const { return m_lastDraws; }
+	size_t GetLastRanges() const { return m_lastRanges; }
+
+private:
+	struct Batch
+	{
+		const Material* material;
+		unsigned int VAO = 0, VBO = 0, EBO = 0;
+		std::vector<Mesh::LodRange> visible;	// filled per Draw
+		std::vector<GLsizei> counts;
+		std::vector<const void*> offsets;
+	};
+
+	struct Cluster
+	{
+		uint32_t batch;
+		int lodCount;
+		Mesh::LodRange lods[Mesh::MAX_LODS];
+		glm::vec3 center;	// world bounding sphere for the level selection
+		float radius;
+	};
+
+	void Release();
+	// merges the ranges of batch.visible that touch into batch.counts/offsets, returns the indices covered
+	static size_t CoalesceVisible(Batch& batch);
+
+	std::vector<Batch> m_batches;
+	std::vector<Cluster> m_clusters;	// by mesh index
+	glm::mat4 m_modelMatrix = glm::mat4(1.0f);
+	bool m_built = false;
+	size_t m_lastDraws = 0;
+	size_t m_lastRanges = 0;
+};
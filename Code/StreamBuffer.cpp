@@ -0,0 +1,140 @@
+#include "StreamBuffer.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// segments start on this, enough for every alignment the draw paths ask for
+	const size_t SEGMENT_ALIGNMENT = 256;
+	// how long one wait on a fence may block before it is retried, in nanoseconds
+	const GLuint64 FENCE_TIMEOUT = 1000000;
+}
+
+unsigned int StreamBuffer::s_buffer = 0;
+uint8_t* StreamBuffer::s_mapped = nullptr;
+size_t StreamBuffer::s_frameBytes = 0;
+size_t StreamBuffer::s_head = 0;
+int StreamBuffer::s_segment = 0;
+bool StreamBuffer::s_started = false;
+bool StreamBuffer::s_warnedFull = false;
+GLsync StreamBuffer::s_fences[StreamBuffer::FRAMES] = {};
+
+void StreamBuffer::Init(size_t frameBytes)
+{
+	s_frameBytes = (frameBytes + SEGMENT_ALIGNMENT - 1) / SEGMENT_ALIGNMENT * SEGMENT_ALIGNMENT;
+	size_t total = s_frameBytes * FRAMES;
+
+	glGenBuffers(1, &s_buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, s_buffer);
+	if (GLAD_GL_VERSION_4_4)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, total, nullptr, flags);
+		s_mapped = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags));
+		if (!s_mapped)
+		{
+			// immutable storage can't be respecified, start over with a plain buffer
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			glDeleteBuffers(1, &s_buffer);
+			glGenBuffers(1, &s_buffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, s_buffer);
+		}
+	}
+	if (!s_mapped)
+		glBufferData(GL_COPY_WRITE_BUFFER, total, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	std::cout << "[StreamBuffer] " << FRAMES << " x " << s_frameBytes / 1024 << " KB, "
+		<< (s_mapped ? "persistent mapping" : "unsynchronized map per write") << std::endl;
+}
+
+void StreamBuffer::Shutdown()
+{
+	for (GLsync& fence : s_fences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (s_mapped)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, s_buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		s_mapped = nullptr;
+	}
+	glDeleteBuffers(1, &s_buffer);
+	s_buffer = 0;
+	s_started = false;
+}
+
+void StreamBuffer::BeginFrame()
+{
+	if (s_buffer == 0)
+		return;
+
+	if (s_started)
+	{
+		s_fences[s_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		s_segment = (s_segment + 1) % FRAMES;
+	}
+	s_started = true;
+	s_head = 0;
+	s_warnedFull = false;
+
+	GLsync fence = s_fences[s_segment];
+	if (!fence)
+		return;
+
+	if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+	{
+		// the GPU is FRAMES frames behind
+		s_stalls++;
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT) == GL_TIMEOUT_EXPIRED)
+			;
+	}
+	glDeleteSync(fence);
+	s_fences[s_segment] = nullptr;
+}
+
+bool StreamBuffer::Write(const void* data, size_t bytes, size_t alignment, size_t& outOffset)
+{
+	size_t offset = (s_head + alignment - 1) / alignment * alignment;
+	if (s_buffer == 0 || offset + bytes > s_frameBytes)
+	{
+		// once per frame it happens in, every refused write is counted
+		if (!s_warnedFull)
+		{
+			std::cout << "[StreamBuffer] frame segment of " << s_frameBytes / 1024 << " KB is full, streamed data dropped" << std::endl;
+			s_warnedFull = true;
+		}
+		s_drops++;
+		return false;
+	}
+
+	size_t absolute = (size_t)s_segment * s_frameBytes + offset;
+	if (s_mapped)
+	{
+		std::memcpy(s_mapped + absolute, data, bytes);
+	}
+	else
+	{
+		// the segment is past its fence, so nothing in flight reads this range
+		glBindBuffer(GL_COPY_WRITE_BUFFER, s_buffer);
+		void* target = glMapBufferRange(GL_COPY_WRITE_BUFFER, absolute, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (target)
+		{
+			std::memcpy(target, data, bytes);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		if (!target)
+			return false;
+	}
+
+	s_head = offset + bytes;
+	s_bytesWritten += bytes;
+	outOffset = absolute;
+	return true;
+}
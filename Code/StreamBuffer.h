@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// One GL buffer for everything the CPU rewrites every frame: instance matrices, bone palettes, text quads.
+// It is split into FRAMES segments used in turn; each frame writes into its own segment, which is fenced at the
+// next BeginFrame and only written again once the GPU has passed that fence. Writes never land on data a draw
+// in flight still reads, so they don't stall on it and nothing has to be orphaned.
+//
+// With GL 4.4 buffer storage the whole ring stays persistently mapped and a write is a memcpy, on plain GL 3.3
+// every write maps its own range unsynchronized.
+//
+// per frame: BeginFrame, then Write from any draw path and point the draw at GetBuffer() + the returned offset
+class StreamBuffer
+{
+public:
+	static const int FRAMES = 3;
+
+	// frameBytes is the room of one frame, the buffer is FRAMES times that
+	static void Init(size_t frameBytes);
+	static void Shutdown();
+
+	// fences last frame's segment and moves on to the next one, waiting for the GPU if it still reads it
+	static void BeginFrame();
+
+	// copies bytes into this frame's segment at a multiple of alignment (at most 256), outOffset is from the start of the buffer.
+	// false when the segment is full, nothing is written then
+	static bool Write(const void* data, size_t bytes, size_t alignment, size_t& outOffset);
+
+	static unsigned int GetBuffer() { return s_buffer; }
+	static size_t GetFrameBytes() { return s_frameBytes; }
+	static bool IsPersistent() { return s_mapped != nullptr; }
+
+	// bytes written, BeginFrame calls that had to wait on a fence and writes refused for lack of room, since the
+	// counters were last reset (see RenderStats)
+	inline static size_t s_bytesWritten = 0;
+	inline static unsigned int s_stalls = 0;
+	inline static unsigned int s_drops = 0;
+
+private:
+	static unsigned int s_buffer;
+	static uint8_t* s_mapped;
+	static size_t s_frameBytes;
+	static size_t s_head;
+	static int s_segment;
+	static bool s_started;
+	static bool s_warnedFull;	// this frame
+	static GLsync s_fences[FRAMES];
+};
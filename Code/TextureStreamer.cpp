@@ -0,0 +1,160 @@
+#include "TextureStreamer.h"
+#include "JobSystem.h"
+
+#include <learnopengl/texture_cache.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+bool TextureStreamer::s_enabled = false;
+size_t TextureStreamer::s_budget = 0;
+uint64_t TextureStreamer::s_frame = 1;
+glm::vec3 TextureStreamer::s_cameraPosition = glm::vec3(0.0f);
+float TextureStreamer::s_pixelsPerUnit = 1.0f;
+
+namespace
+{
+	// a texture not drawn for this many frames gives up its streamed levels first
+	const uint64_t UNUSED_FRAMES = 120;
+	// level loads started per frame, keeps a camera cut from flooding the loaders
+	const int MAX_LOADS_PER_FRAME = 4;
+
+	bool IsUnwanted(const CachedTexture& texture)
+	{
+		return texture.residentLevel < texture.wantedLevel;
+	}
+}
+
+void TextureStreamer::Init(size_t budgetBytes, uint32_t initialSize)
+{
+	s_enabled = initialSize > 0;
+	s_budget = budgetBytes;
+	CachedTexture::s_streamInitialSize = initialSize;
+}
+
+void TextureStreamer::BeginFrame(const glm::vec3& cameraPosition, float fovDegrees, float viewportHeight)
+{
+	s_frame++;
+	s_cameraPosition = cameraPosition;
+	s_pixelsPerUnit = viewportHeight / (2.0f * std::tan(glm::radians(fovDegrees) * 0.5f));
+}
+
+void TextureStreamer::Update()
+{
+	if (!s_enabled)
+		return;
+
+	std::vector<std::shared_ptr<CachedTexture>> textures = TextureCache::Resident();
+
+	size_t residentBytes = 0;
+	size_t incomingBytes = 0;
+	for (const std::shared_ptr<CachedTexture>& texture : textures)
+	{
+		residentBytes += texture->bytes;
+		if (!texture->streamable)
+			continue;
+
+		if (texture->streaming)
+			incomingBytes += texture->LevelBytes(texture->residentLevel - 1);
+		if (s_frame - texture->lastUsedFrame > UNUSED_FRAMES)
+			texture->wantedLevel = texture->minimumLevel;
+	}
+
+	// drops one streamed level: detail no draw wants any more goes first, then the least recently used.
+	// textures drawn this frame at their current detail are never touched
+	auto evictOne = [&](const CachedTexture* keep)
+	{
+		CachedTexture* victim = nullptr;
+		for (const std::shared_ptr<CachedTexture>& candidate : textures)
+		{
+			CachedTexture* texture = candidate.get();
+			if (!texture->streamable || texture->streaming || texture == keep || texture->residentLevel >= texture->minimumLevel)
+				continue;
+			if (!IsUnwanted(*texture) && texture->lastUsedFrame == s_frame)
+				continue;
+
+			if (!victim || (IsUnwanted(*texture) && !IsUnwanted(*victim))
+				|| (IsUnwanted(*texture) == IsUnwanted(*victim) && texture->lastUsedFrame < victim->lastUsedFrame))
+				victim = texture;
+		}
+
+		if (!victim)
+			return false;
+
+		residentBytes -= victim->LevelBytes(victim->residentLevel);
+		victim->EvictFinestLevel();
+		return true;
+	};
+
+	while (residentBytes + incomingBytes > s_budget && evictOne(nullptr))
+		;
+
+	// biggest detail deficit first, one level per texture and frame so detail sharpens coarse to fine
+	std::vector<std::shared_ptr<CachedTexture>> wanting;
+	for (const std::shared_ptr<CachedTexture>& texture : textures)
+		if (texture->streamable && !texture->streaming && texture->wantedLevel < texture->residentLevel)
+			wanting.push_back(texture);
+
+	std::sort(wanting.begin(), wanting.end(), [](const std::shared_ptr<CachedTexture>& a, const std::shared_ptr<CachedTexture>& b)
+	{
+		return a->residentLevel - a->wantedLevel > b->residentLevel - b->wantedLevel;
+	});
+
+	int loads = 0;
+	for (const std::shared_ptr<CachedTexture>& texture : wanting)
+	{
+		if (loads == MAX_LOADS_PER_FRAME)
+			break;
+
+		uint32_t level = texture->residentLevel - 1;
+		size_t size = texture->LevelBytes(level);
+		while (residentBytes + incomingBytes + size > s_budget && evictOne(texture.get()))
+			;
+		if (residentBytes + incomingBytes + size > s_budget)
+			continue;
+
+		incomingBytes += size;
+		texture->streaming = true;
+		loads++;
+
+		std::shared_ptr<CachedTexture> streamed = texture;
+		JobSystem::Submit([streamed, level]()
+		{
+			// the copy faults the level's pages in on the worker, the GL thread only sees memory
+			auto data = std::make_shared<std::vector<unsigned char>>(streamed->ReadLevel(level));
+			GLUploadQueue::Push([streamed, level, data]() { streamed->StreamIn(level, data->data()); });
+		});
+	}
+}
+
+void TextureStreamer::Report()
+{
+	std::vector<std::shared_ptr<CachedTexture>> textures = TextureCache::Resident();
+
+	size_t residentTotal = 0, fullTotal = 0;
+	std::cout << "\n[TextureStreamer] " << (s_enabled ? "resident mips" : "disabled, whole chains resident") << std::endl;
+	for (const std::shared_ptr<CachedTexture>& texture : textures)
+	{
+		residentTotal += texture->bytes;
+		if (!texture->streamable)
+		{
+			fullTotal += texture->bytes;
+			std::cout << "  " << texture->path << " | " << texture->bytes / 1024 << " KB, not streamed" << std::endl;
+			continue;
+		}
+
+		size_t full = 0;
+		for (uint32_t level = 0; level < texture->mipCount; level++)
+			full += texture->LevelBytes(level);
+		fullTotal += full;
+
+		std::cout << "  " << texture->path << " | mip " << texture->residentLevel << " (wanted " << texture->wantedLevel
+			<< ", min " << texture->minimumLevel << (texture->streaming ? ", loading" : "") << ") | "
+			<< texture->bytes / 1024 << " / " << full / 1024 << " KB" << std::endl;
+	}
+	std::cout << "[TextureStreamer] " << residentTotal / 1024 << " KB resident of " << fullTotal / 1024 << " KB full chains, budget "
+		<< s_budget / 1024 << " KB" << std::endl;
+}
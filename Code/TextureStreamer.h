@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// Mip streaming for cooked textures. Only the coarse tail of every mip chain is uploaded at load time,
+// finer levels are read on the JobSystem and uploaded through the GLUploadQueue once a draw asks for them.
+// Levels nobody asked for are dropped again whenever the resident total goes over the byte budget.
+//
+// per frame: BeginFrame, Request for every model drawn, Update after the frame's draws
+class TextureStreamer
+{
+public:
+	// initialSize: largest side of the mips uploaded up front, 0 disables streaming (whole chains resident)
+	static void Init(size_t budgetBytes, uint32_t initialSize);
+	static void SetBudget(size_t budgetBytes) { s_budget = budgetBytes; }
+	static bool IsEnabled() { return s_enabled; }
+
+	static void BeginFrame(const glm::vec3& cameraPosition, float fovDegrees, float viewportHeight);
+
+	// records the detail the model's textures need at this size on screen, any model with RequestTextureDetail
+	template <typename ModelT>
+	static void Request(ModelT& model, const glm::mat4& modelMatrix)
+	{
+		if (s_enabled)
+			model.RequestTextureDetail(modelMatrix, s_cameraPosition, s_pixelsPerUnit, s_frame);
+	}
+
+	// evicts over budget and schedules the next level of every texture that wants more detail
+	static void Update();
+
+	// resident bytes per texture against the full chain
+	static void Report();
+
+private:
+	static bool s_enabled;
+	static size_t s_budget;
+	static uint64_t s_frame;
+	static glm::vec3 s_cameraPosition;
+	static float s_pixelsPerUnit;
+};
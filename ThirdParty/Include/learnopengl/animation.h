@@ -23,6 +23,12 @@ public:
 	Animation() = default;
 
 	Animation(const std::string& animationPath, Model_Bone* model)  // Changed from Model* to Model_Bone*
+	{
+		Load(animationPath, model);
+	}
+
+	// reads the clip and registers its bones on the model, safe on a loader thread
+	void Load(const std::string& animationPath, Model_Bone* model)
 	{
 		Assimp::Importer importer;
 		const aiScene* scene = importer.ReadFile(animationPath, aiProcess_Triangulate);
@@ -33,6 +39,8 @@ public:
 		aiMatrix4x4 globalTransformation = scene->mRootNode->mTransformation;
 		globalTransformation = globalTransformation.Inverse();
 		ReadHierarchyData(m_RootNode, scene->mRootNode);
+
+		std::lock_guard<std::mutex> lock(model->GetBoneMutex());
 		ReadMissingBones(animation, *model);
 	}
 
@@ -74,6 +82,16 @@ public:
 	inline float GetTicksPerSecond() { return m_TicksPerSecond; }
 	inline float GetDuration() { return m_Duration; }
 	inline const AssimpNodeData& GetRootNode() { return m_RootNode; }
+	// keyframe data held by the clip
+	size_t GetMemoryBytes() const
+	{
+		size_t bytes = sizeof(Animation);
+		for (const Bone& bone : m_Bones)
+			bytes += bone.m_Positions.size() * sizeof(KeyPosition)
+				+ bone.m_Rotations.size() * sizeof(KeyRotation)
+				+ bone.m_Scales.size() * sizeof(KeyScale);
+		return bytes;
+	}
 	inline const std::map<std::string, BoneInfo>& GetBoneIDMap()
 	{
 		return m_BoneInfoMap;
@@ -175,7 +175,7 @@ public:
 
 	}
 
-	std::vector<glm::mat4> GetFinalBoneMatrices()
+	const std::vector<glm::mat4>& GetFinalBoneMatrices() const
 	{
 		return m_FinalBoneMatrices;
 	}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <learnopengl/mapped_file.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The image based lighting maps Renderer::SetupPBR precomputes from an HDR environment, saved after the first run
+// and read straight back into textures on later ones. They depend only on the HDR, so that is the key.
+//
+// layout: Header | environment level 0 faces | irradiance faces | prefilter faces, mip by mip | BRDF LUT
+// cube faces in GL order +X -X +Y -Y +Z -Z, RGB half floats; the LUT RG half floats. The environment's mips are
+// regenerated on load, they are only a box filter of level 0.
+namespace CookedIBL
+{
+    const uint32_t MAGIC = 0x4C424942; // "BIBL"
+    // bump whenever the layout or any of the precompute shaders change
+    const uint32_t VERSION = 1;
+    const char* const DIRECTORY = "Assets/Cooked";
+
+    // sizes SetupPBR renders at
+    const int ENVIRONMENT_SIZE = 512;
+    const int IRRADIANCE_SIZE = 32;
+    const int PREFILTER_SIZE = 128;
+    const int PREFILTER_MIPS = 5;
+    const int BRDF_SIZE = 512;
+
+    inline bool s_enabled = true;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceHash;
+        uint64_t fileSize;
+    };
+
+    inline size_t CubeLevelBytes(int size)
+    {
+        return (size_t)size * size * 3 * sizeof(uint16_t) * 6;
+    }
+
+    inline size_t FileSize()
+    {
+        size_t size = sizeof(Header) + CubeLevelBytes(ENVIRONMENT_SIZE) + CubeLevelBytes(IRRADIANCE_SIZE);
+        for (int mip = 0; mip < PREFILTER_MIPS; mip++)
+            size += CubeLevelBytes(PREFILTER_SIZE >> mip);
+        return size + (size_t)BRDF_SIZE * BRDF_SIZE * 2 * sizeof(uint16_t);
+    }
+
+    // hash of the HDR file contents and the precompute version, 0 when unreadable
+    inline uint64_t SourceHash(const std::string& sourcePath)
+    {
+        MappedFile source(sourcePath);
+        if (!source.IsOpen())
+            return 0;
+
+        uint64_t hash = HashBytes(&VERSION, sizeof(VERSION));
+        return HashBytes(source.Data(), source.Size(), hash);
+    }
+
+    inline std::string CookedPath(uint64_t hash)
+    {
+        return ::CookedPath(DIRECTORY, hash, ".bibl");
+    }
+
+    inline void SetCubeParameters(bool mipmapped)
+    {
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    // uploads one level of all six faces from data, returns the bytes read
+    inline size_t UploadCubeLevel(int level, int size, const unsigned char* data)
+    {
+        size_t faceBytes = CubeLevelBytes(size) / 6;
+        for (int face = 0; face < 6; face++)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB16F, size, size, 0, GL_RGB, GL_HALF_FLOAT, data + face * faceBytes);
+        return faceBytes * 6;
+    }
+
+    inline void ReadCubeLevel(GLuint texture, int level, int size, std::vector<unsigned char>& out)
+    {
+        size_t faceBytes = CubeLevelBytes(size) / 6;
+        size_t start = out.size();
+        out.resize(start + faceBytes * 6);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+        for (int face = 0; face < 6; face++)
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB, GL_HALF_FLOAT, out.data() + start + face * faceBytes);
+    }
+
+    // Creates the four textures from a cooked file. Returns false, creating nothing, when it is missing, stale or malformed
+    inline bool Read(const std::string& cookedPath, uint64_t hash, unsigned int& environment, unsigned int& irradiance, unsigned int& prefilter, unsigned int& brdfLUT)
+    {
+        if (!s_enabled || hash == 0)
+            return false;
+
+        MappedFile file(cookedPath);
+        if (!file.IsOpen() || file.Size() < sizeof(Header))
+            return false;
+        const Header* header = (const Header*)file.Data();
+        if (header->magic != MAGIC || header->version != VERSION || header->sourceHash != hash
+            || header->fileSize != FileSize() || file.Size() != FileSize())
+            return false;
+
+        const unsigned char* data = file.Data() + sizeof(Header);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        glGenTextures(1, &environment);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, environment);
+        data += UploadCubeLevel(0, ENVIRONMENT_SIZE, data);
+        SetCubeParameters(true);
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
+        glGenTextures(1, &irradiance);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, irradiance);
+        data += UploadCubeLevel(0, IRRADIANCE_SIZE, data);
+        SetCubeParameters(false);
+
+        // only the rendered roughness levels exist, the chain stops there
+        glGenTextures(1, &prefilter);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, prefilter);
+        for (int mip = 0; mip < PREFILTER_MIPS; mip++)
+            data += UploadCubeLevel(mip, PREFILTER_SIZE >> mip, data);
+        SetCubeParameters(true);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, PREFILTER_MIPS - 1);
+
+        glGenTextures(1, &brdfLUT);
+        glBindTexture(GL_TEXTURE_2D, brdfLUT);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, BRDF_SIZE, BRDF_SIZE, 0, GL_RG, GL_HALF_FLOAT, data);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        return true;
+    }
+
+    // reads the rendered maps back from GL and writes them, false if the file couldn't be written
+    inline bool Write(const std::string& cookedPath, uint64_t hash, unsigned int environment, unsigned int irradiance, unsigned int prefilter, unsigned int brdfLUT)
+    {
+        if (hash == 0)
+            return false;
+
+        Header header = { MAGIC, VERSION, hash, FileSize() };
+        std::vector<unsigned char> pixels;
+        pixels.reserve(FileSize() - sizeof(Header));
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        ReadCubeLevel(environment, 0, ENVIRONMENT_SIZE, pixels);
+        ReadCubeLevel(irradiance, 0, IRRADIANCE_SIZE, pixels);
+        for (int mip = 0; mip < PREFILTER_MIPS; mip++)
+            ReadCubeLevel(prefilter, mip, PREFILTER_SIZE >> mip, pixels);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        size_t start = pixels.size();
+        pixels.resize(start + (size_t)BRDF_SIZE * BRDF_SIZE * 2 * sizeof(uint16_t));
+        glBindTexture(GL_TEXTURE_2D, brdfLUT);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_HALF_FLOAT, pixels.data() + start);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+        return WriteFileAtomically(cookedPath, header, pixels);
+    }
+}
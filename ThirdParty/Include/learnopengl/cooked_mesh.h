@@ -0,0 +1,297 @@
+#pragma once
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/animdata.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Binary container for imported models, written once per source file and memory mapped on later runs.
+//
+// layout: Header | SubMesh[meshCount] | TextureRef[textureCount] | BoneRef[boneCount] | vertex blob | index blob
+// the vertex blob holds the packed vertices (PackedStaticVertex or PackedSkinnedVertex) of every submesh back to
+// back, the index blob the matching indices. Both are 16 byte aligned so they can be handed to glBufferData straight from the mapping.
+namespace CookedMesh
+{
+    const uint32_t MAGIC = 0x48534D42; // "BMSH"
+    // bump whenever the layout or the packed vertex structs change
+    const uint32_t VERSION = 5;
+    const char* const DIRECTORY = "Assets/Cooked";
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceHash;
+        float importMs;         // Assimp import time when the file was cooked, for the load time log
+        uint32_t skinned;
+        uint32_t vertexStride;
+        uint32_t meshCount;
+        uint32_t textureCount;
+        uint32_t boneCount;
+        int32_t boneCounter;
+        uint32_t padding;
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint64_t fileSize;
+    };
+
+    struct SubMesh
+    {
+        uint32_t firstVertex;
+        uint32_t vertexCount;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t firstTexture;
+        uint32_t textureCount;
+        // detail levels inside the submesh's indices (see mesh_simplify.h), relative to firstIndex
+        uint32_t lodCount;
+        uint32_t lodFirstIndex[Mesh::MAX_LODS];
+        uint32_t lodIndexCount[Mesh::MAX_LODS];
+    };
+
+    struct TextureRef
+    {
+        char type[32];
+        char path[224];
+    };
+
+    struct BoneRef
+    {
+        char name[124];
+        int32_t id;
+        float offset[16];
+    };
+
+    inline uint64_t Align16(uint64_t offset)
+    {
+        return (offset + 15) & ~uint64_t(15);
+    }
+
+    // the fixed size strings must end inside their array
+    template<size_t N>
+    inline bool Terminated(const char (&text)[N])
+    {
+        return memchr(text, 0, N) != nullptr;
+    }
+
+    inline uint32_t VertexStride(bool skinned)
+    {
+        return skinned ? sizeof(PackedSkinnedVertex) : sizeof(PackedStaticVertex);
+    }
+
+    // every table, range and string of a mapped file lies inside it and every index inside its submesh.
+    // the header's vertexStride must have been checked first
+    inline bool Validate(const unsigned char* base, const Header* header)
+    {
+        uint64_t tablesEnd = sizeof(Header) + (uint64_t)header->meshCount * sizeof(SubMesh)
+            + (uint64_t)header->textureCount * sizeof(TextureRef) + (uint64_t)header->boneCount * sizeof(BoneRef);
+        if (tablesEnd > header->vertexOffset || header->vertexOffset > header->indexOffset || header->indexOffset > header->fileSize
+            || header->vertexOffset % 16 != 0 || header->indexOffset % 16 != 0)
+            return false;
+        uint64_t vertexCapacity = (header->indexOffset - header->vertexOffset) / header->vertexStride;
+        uint64_t indexCapacity = (header->fileSize - header->indexOffset) / sizeof(unsigned int);
+
+        const SubMesh* subMeshes = (const SubMesh*)(base + sizeof(Header));
+        const TextureRef* textureRefs = (const TextureRef*)(subMeshes + header->meshCount);
+        const BoneRef* boneRefs = (const BoneRef*)(textureRefs + header->textureCount);
+        const unsigned int* indexBlob = (const unsigned int*)(base + header->indexOffset);
+
+        for (uint32_t i = 0; i < header->meshCount; i++)
+        {
+            const SubMesh& sub = subMeshes[i];
+            if ((uint64_t)sub.firstVertex + sub.vertexCount > vertexCapacity || (uint64_t)sub.firstIndex + sub.indexCount > indexCapacity
+                || (uint64_t)sub.firstTexture + sub.textureCount > header->textureCount || sub.lodCount > (uint32_t)Mesh::MAX_LODS)
+                return false;
+            for (uint32_t lod = 0; lod < sub.lodCount; lod++)
+                if ((uint64_t)sub.lodFirstIndex[lod] + sub.lodIndexCount[lod] > sub.indexCount)
+                    return false;
+            for (uint32_t index = 0; index < sub.indexCount; index++)
+                if (indexBlob[sub.firstIndex + index] >= sub.vertexCount)
+                    return false;
+        }
+        for (uint32_t i = 0; i < header->textureCount; i++)
+            if (!Terminated(textureRefs[i].type) || !Terminated(textureRefs[i].path))
+                return false;
+        for (uint32_t i = 0; i < header->boneCount; i++)
+            if (!Terminated(boneRefs[i].name))
+                return false;
+        return true;
+    }
+
+    // copies text into a fixed size string, false when it doesn't fit
+    template<size_t N>
+    inline bool CopyString(char (&out)[N], const std::string& text)
+    {
+        if (text.size() >= N)
+            return false;
+        memcpy(out, text.c_str(), text.size() + 1);
+        return true;
+    }
+
+    // hash of the source file contents and the loader kind ('S' static, 'B' skinned), 0 when unreadable
+    inline uint64_t SourceHash(const std::string& sourcePath, char kind)
+    {
+        MappedFile source(sourcePath);
+        if (!source.IsOpen())
+            return 0;
+
+        uint64_t hash = HashBytes(&kind, 1);
+        hash = HashBytes(&VERSION, sizeof(VERSION), hash);
+        return HashBytes(source.Data(), source.Size(), hash);
+    }
+
+    inline std::string CookedPath(uint64_t hash)
+    {
+        return ::CookedPath(DIRECTORY, hash, ".bmesh");
+    }
+
+    // Maps a cooked file and builds meshes pointing into it. Returns null when the file is missing,
+    // stale or malformed; the mapping must outlive the meshes' Upload
+    inline std::unique_ptr<MappedFile> Read(const std::string& cookedPath, uint64_t hash, bool skinned, std::vector<Mesh>& meshes,
+        std::map<std::string, BoneInfo>* bones, int* boneCounter, float* importMs)
+    {
+        auto file = std::make_unique<MappedFile>(cookedPath);
+        if (!file->IsOpen() || file->Size() < sizeof(Header))
+            return nullptr;
+
+        const unsigned char* base = file->Data();
+        const Header* header = (const Header*)base;
+        if (header->magic != MAGIC || header->version != VERSION || header->sourceHash != hash
+            || header->vertexStride != VertexStride(skinned) || header->skinned != (skinned ? 1u : 0u) || header->fileSize != file->Size()
+            || !Validate(base, header))
+            return nullptr;
+
+        const SubMesh* subMeshes = (const SubMesh*)(base + sizeof(Header));
+        const TextureRef* textureRefs = (const TextureRef*)(subMeshes + header->meshCount);
+        const BoneRef* boneRefs = (const BoneRef*)(textureRefs + header->textureCount);
+        const unsigned char* vertexBlob = base + header->vertexOffset;
+        const unsigned int* indexBlob = (const unsigned int*)(base + header->indexOffset);
+
+        for (uint32_t i = 0; i < header->meshCount; i++)
+        {
+            const SubMesh& sub = subMeshes[i];
+            vector<Texture> textures;
+            for (uint32_t t = 0; t < sub.textureCount; t++)
+            {
+                const TextureRef& ref = textureRefs[sub.firstTexture + t];
+                textures.push_back(Texture{ 0, ref.type, ref.path });
+            }
+            meshes.push_back(Mesh(vertexBlob + (uint64_t)sub.firstVertex * header->vertexStride, sub.vertexCount, indexBlob + sub.firstIndex, sub.indexCount, textures));
+            for (uint32_t lod = 0; lod < sub.lodCount && lod < (uint32_t)Mesh::MAX_LODS; lod++)
+                meshes.back().lods.push_back(Mesh::LodRange{ sub.lodFirstIndex[lod], sub.lodIndexCount[lod] });
+        }
+
+        if (bones)
+        {
+            for (uint32_t i = 0; i < header->boneCount; i++)
+            {
+                BoneInfo info;
+                info.id = boneRefs[i].id;
+                memcpy(&info.offset[0][0], boneRefs[i].offset, sizeof(boneRefs[i].offset));
+                (*bones)[boneRefs[i].name] = info;
+            }
+            *boneCounter = header->boneCounter;
+        }
+
+        *importMs = header->importMs;
+        return file;
+    }
+
+    // Writes freshly imported meshes (with their vertex/index vectors filled) to a cooked file
+    inline bool Write(const std::string& cookedPath, uint64_t hash, float importMs, bool skinned, const std::vector<Mesh>& meshes,
+        const std::map<std::string, BoneInfo>* bones, int boneCounter)
+    {
+        Header header = {};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.sourceHash = hash;
+        header.importMs = importMs;
+        header.skinned = skinned ? 1 : 0;
+        header.vertexStride = VertexStride(skinned);
+        header.meshCount = (uint32_t)meshes.size();
+        header.boneCount = bones ? (uint32_t)bones->size() : 0;
+        header.boneCounter = boneCounter;
+
+        std::vector<SubMesh> subMeshes;
+        std::vector<TextureRef> textureRefs;
+        uint32_t vertexCount = 0, indexCount = 0;
+        for (const Mesh& mesh : meshes)
+        {
+            SubMesh sub = {};
+            sub.firstVertex = vertexCount;
+            sub.vertexCount = (uint32_t)mesh.vertices.size();
+            sub.firstIndex = indexCount;
+            sub.indexCount = (uint32_t)mesh.indices.size();
+            sub.firstTexture = (uint32_t)textureRefs.size();
+            sub.textureCount = (uint32_t)mesh.textures.size();
+            sub.lodCount = (uint32_t)std::min(mesh.lods.size(), (size_t)Mesh::MAX_LODS);
+            for (uint32_t lod = 0; lod < sub.lodCount; lod++)
+            {
+                sub.lodFirstIndex[lod] = mesh.lods[lod].firstIndex;
+                sub.lodIndexCount[lod] = mesh.lods[lod].indexCount;
+            }
+            subMeshes.push_back(sub);
+            vertexCount += sub.vertexCount;
+            indexCount += sub.indexCount;
+
+            for (const Texture& texture : mesh.textures)
+            {
+                TextureRef ref = {};
+                if (!CopyString(ref.type, texture.type) || !CopyString(ref.path, texture.path))
+                {
+                    cout << "[CookedMesh] texture path too long to cook, " << cookedPath << " not written: " << texture.path << endl;
+                    return false;
+                }
+                textureRefs.push_back(ref);
+            }
+        }
+        header.textureCount = (uint32_t)textureRefs.size();
+
+        std::vector<BoneRef> boneRefs;
+        if (bones)
+        {
+            for (auto& [name, info] : *bones)
+            {
+                BoneRef ref = {};
+                if (!CopyString(ref.name, name))
+                {
+                    cout << "[CookedMesh] bone name too long to cook, " << cookedPath << " not written: " << name << endl;
+                    return false;
+                }
+                ref.id = info.id;
+                memcpy(ref.offset, &info.offset[0][0], sizeof(ref.offset));
+                boneRefs.push_back(ref);
+            }
+        }
+
+        uint64_t tablesEnd = sizeof(Header) + subMeshes.size() * sizeof(SubMesh)
+            + textureRefs.size() * sizeof(TextureRef) + boneRefs.size() * sizeof(BoneRef);
+        header.vertexOffset = Align16(tablesEnd);
+        header.indexOffset = Align16(header.vertexOffset + (uint64_t)vertexCount * header.vertexStride);
+        header.fileSize = header.indexOffset + (uint64_t)indexCount * sizeof(unsigned int);
+
+        return WriteFileAtomically(cookedPath, [&](std::ostream& out) {
+            const char zeros[16] = {};
+            out.write((const char*)&header, sizeof(header));
+            out.write((const char*)subMeshes.data(), subMeshes.size() * sizeof(SubMesh));
+            out.write((const char*)textureRefs.data(), textureRefs.size() * sizeof(TextureRef));
+            out.write((const char*)boneRefs.data(), boneRefs.size() * sizeof(BoneRef));
+            out.write(zeros, header.vertexOffset - tablesEnd);
+            for (const Mesh& mesh : meshes)
+            {
+                vector<unsigned char> packed = Mesh::PackVertices(mesh.vertices.data(), mesh.vertices.size(), skinned);
+                out.write((const char*)packed.data(), packed.size());
+            }
+            out.write(zeros, header.indexOffset - (header.vertexOffset + (uint64_t)vertexCount * header.vertexStride));
+            for (const Mesh& mesh : meshes)
+                out.write((const char*)mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+        });
+    }
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/texture_compress.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// EXT_texture_compression_s3tc enums, not part of the core profile glad was generated for
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Binary container for textures with the whole mip chain generated (and optionally block compressed) at cook time.
+//
+// layout: Header | Level[mipCount] | level data
+// every level starts 16 byte aligned and is handed to glCompressedTexImage2D straight from the mapping.
+namespace CookedTexture
+{
+    const uint32_t MAGIC = 0x58455442; // "BTEX"
+    // bump whenever the layout or the encoders change
+    const uint32_t VERSION = 1;
+    const char* const DIRECTORY = "Assets/Cooked";
+
+    using Format = TextureCompress::Format;
+
+    // how the texture is sampled, normal maps only need two channels and go to BC5
+    enum class Usage : uint32_t { Color = 0, Normal };
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceHash;
+        float decodeMs;         // stb decode time when the file was cooked, for the load time log
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t components;    // of the source image
+        uint32_t mipCount;
+        uint64_t sourceBytes;   // what the uncompressed upload with glGenerateMipmap occupied
+        uint64_t fileSize;
+    };
+
+    struct Level
+    {
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    // off: textures are decoded from the source and mipmapped by the driver like before, for comparison
+    inline bool s_enabled = true;
+    // S3TC is an extension, without it colour textures are cooked as plain RGBA8 mip chains
+    inline bool s_s3tcSupported = false;
+
+    // queries the compressed formats the context supports, GL thread only
+    inline void DetectSupport()
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (name && std::string(name) == "GL_EXT_texture_compression_s3tc")
+                s_s3tcSupported = true;
+        }
+    }
+
+    inline const char* FormatName(Format format)
+    {
+        switch (format)
+        {
+        case Format::BC1: return "BC1";
+        case Format::BC3: return "BC3";
+        case Format::BC5: return "BC5";
+        default: return "RGBA8";
+        }
+    }
+
+    inline GLenum GLFormat(Format format)
+    {
+        switch (format)
+        {
+        case Format::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case Format::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case Format::BC5: return GL_COMPRESSED_RG_RGTC2;
+        default: return GL_RGBA8;
+        }
+    }
+
+    // RGTC is core since 3.0, S3TC depends on the extension
+    inline Format ChooseFormat(Usage usage, int components)
+    {
+        if (usage == Usage::Normal)
+            return Format::BC5;
+        if (!s_s3tcSupported)
+            return Format::RGBA8;
+        return components == 4 ? Format::BC3 : Format::BC1;
+    }
+
+    // hash of the source file contents, the usage and whether S3TC was available, 0 when unreadable
+    inline uint64_t SourceHash(const std::string& sourcePath, Usage usage)
+    {
+        MappedFile source(sourcePath);
+        if (!source.IsOpen())
+            return 0;
+
+        uint64_t hash = HashBytes(&usage, sizeof(usage));
+        hash = HashBytes(&VERSION, sizeof(VERSION), hash);
+        hash = HashBytes(&s_s3tcSupported, sizeof(s_s3tcSupported), hash);
+        return HashBytes(source.Data(), source.Size(), hash);
+    }
+
+    // the usage is in the hash already, the suffix keeps the color and normal map cooks of one file apart at a glance
+    inline std::string CookedPath(uint64_t hash, Usage usage)
+    {
+        return ::CookedPath(DIRECTORY, hash, usage == Usage::Normal ? ".normal.btex" : ".color.btex");
+    }
+
+    // the format is one this build knows, the mip chain halves from the header's size down and every level's data
+    // lies inside the file with exactly the bytes its size takes in that format
+    inline bool Validate(const unsigned char* base, const Header* header)
+    {
+        if (header->format > (uint32_t)Format::BC5 || header->width == 0 || header->height == 0)
+            return false;
+
+        const Level* levels = (const Level*)(base + sizeof(Header));
+        uint32_t width = header->width, height = header->height;
+        for (uint32_t i = 0; i < header->mipCount; i++)
+        {
+            const Level& level = levels[i];
+            if (level.width != width || level.height != height
+                || level.offset > header->fileSize || level.size > header->fileSize - level.offset
+                || level.size != TextureCompress::LevelBytes((Format)header->format, (int)width, (int)height))
+                return false;
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+        return true;
+    }
+
+    // Maps a cooked file, null when it is missing, stale or malformed
+    inline std::unique_ptr<MappedFile> Read(const std::string& cookedPath, uint64_t hash)
+    {
+        auto file = std::make_unique<MappedFile>(cookedPath);
+        if (!file->IsOpen() || file->Size() < sizeof(Header))
+            return nullptr;
+
+        const Header* header = (const Header*)file->Data();
+        if (header->magic != MAGIC || header->version != VERSION || header->sourceHash != hash || header->fileSize != file->Size()
+            || header->mipCount == 0 || header->mipCount > 32 || sizeof(Header) + header->mipCount * sizeof(Level) > file->Size()
+            || !Validate(file->Data(), header))
+            return nullptr;
+
+        return file;
+    }
+
+    // Decodes the source, builds the mip chain, encodes every level and writes the cooked file. Slow, loader threads only
+    inline bool Cook(const std::string& sourcePath, const std::string& cookedPath, uint64_t hash, Usage usage)
+    {
+        auto decodeBegin = std::chrono::high_resolution_clock::now();
+        int width = 0, height = 0, components = 0;
+        unsigned char* pixels = stbi_load(sourcePath.c_str(), &width, &height, &components, 4);
+        float decodeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - decodeBegin).count();
+        if (!pixels)
+            return false;
+
+        std::vector<unsigned char> level(pixels, pixels + (size_t)width * height * 4);
+        stbi_image_free(pixels);
+
+        // stb expands to RGBA, keep one and two channel images reading like their GL_RED/GL_RG uploads did
+        if (components < 3)
+            for (size_t i = 0; i < level.size(); i += 4)
+            {
+                if (components == 1)
+                    level[i + 1] = 0;
+                level[i + 2] = 0;
+                level[i + 3] = 255;
+            }
+
+        Header header = {};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.sourceHash = hash;
+        header.decodeMs = decodeMs;
+        header.format = (uint32_t)ChooseFormat(usage, components);
+        header.width = width;
+        header.height = height;
+        header.components = components;
+
+        std::vector<Level> levels;
+        std::vector<std::vector<unsigned char>> encoded;
+        int w = width, h = height;
+        while (true)
+        {
+            encoded.push_back(TextureCompress::Encode(level, w, h, (Format)header.format));
+            levels.push_back(Level{ (uint32_t)w, (uint32_t)h, 0, encoded.back().size() });
+            header.sourceBytes += (uint64_t)w * h * std::max(components, 1);
+
+            if (w == 1 && h == 1)
+                break;
+            level = TextureCompress::Downsample(level, w, h);
+            w = std::max(w / 2, 1);
+            h = std::max(h / 2, 1);
+        }
+        header.mipCount = (uint32_t)levels.size();
+
+        uint64_t offset = sizeof(Header) + levels.size() * sizeof(Level);
+        for (Level& entry : levels)
+        {
+            entry.offset = (offset + 15) & ~uint64_t(15);
+            offset = entry.offset + entry.size;
+        }
+        header.fileSize = offset;
+
+        return WriteFileAtomically(cookedPath, [&](std::ostream& out) {
+            const char zeros[16] = {};
+            out.write((const char*)&header, sizeof(header));
+            out.write((const char*)levels.data(), levels.size() * sizeof(Level));
+            uint64_t written = sizeof(Header) + levels.size() * sizeof(Level);
+            for (size_t i = 0; i < levels.size(); i++)
+            {
+                out.write(zeros, levels[i].offset - written);
+                out.write((const char*)encoded[i].data(), encoded[i].size());
+                written = levels[i].offset + levels[i].size;
+            }
+        });
+    }
+
+    inline const Header& GetHeader(const MappedFile& file)
+    {
+        return *(const Header*)file.Data();
+    }
+
+    inline const Level& GetLevel(const MappedFile& file, uint32_t index)
+    {
+        return ((const Level*)(file.Data() + sizeof(Header)))[index];
+    }
+
+    // first level no larger than maxSize on either side, what gets uploaded up front when streaming
+    inline uint32_t FirstLevelWithin(const MappedFile& file, uint32_t maxSize)
+    {
+        const Header& header = GetHeader(file);
+        uint32_t index = 0;
+        while (index + 1 < header.mipCount && std::max(GetLevel(file, index).width, GetLevel(file, index).height) > maxSize)
+            index++;
+        return index;
+    }
+
+    // (re)specifies one level of a bound texture, data null with a 0x0 size drops the level's storage. GL thread only
+    inline void SpecifyLevel(Format format, uint32_t index, uint32_t width, uint32_t height, const void* data, size_t size)
+    {
+        if (format == Format::RGBA8)
+            glTexImage2D(GL_TEXTURE_2D, index, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        else
+            glCompressedTexImage2D(GL_TEXTURE_2D, index, GLFormat(format), width, height, 0, (GLsizei)size, data);
+    }
+
+    // Creates the GL texture from a mapped cooked file, one glCompressedTexImage2D per level from baseLevel down.
+    // Levels above baseLevel stay undefined until streamed in. GL thread only
+    inline unsigned int Upload(const MappedFile& file, uint32_t baseLevel, size_t* gpuBytes)
+    {
+        const Header& header = GetHeader(file);
+        Format format = (Format)header.format;
+
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.mipCount - 1);
+
+        *gpuBytes = 0;
+        for (uint32_t i = baseLevel; i < header.mipCount; i++)
+        {
+            const Level& level = GetLevel(file, i);
+            SpecifyLevel(format, i, level.width, level.height, file.Data() + level.offset, level.size);
+            *gpuBytes += level.size;
+        }
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        return textureID;
+    }
+}
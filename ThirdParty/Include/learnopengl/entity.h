@@ -6,6 +6,8 @@
 #include <array> //std::array
 #include <memory> //std::unique_ptr
 
+#include <learnopengl/frustum.h> //Plane, Frustum
+
 class Transform
 {
 protected:
@@ -122,36 +124,6 @@ public:
 	}
 };
 
-struct Plane
-{
-	glm::vec3 normal = { 0.f, 1.f, 0.f }; // unit vector
-	float     distance = 0.f;        // Distance with origin
-
-	Plane() = default;
-
-	Plane(const glm::vec3& p1, const glm::vec3& norm)
-		: normal(glm::normalize(norm)),
-		distance(glm::dot(normal, p1))
-	{}
-
-	float getSignedDistanceToPlane(const glm::vec3& point) const
-	{
-		return glm::dot(normal, point) - distance;
-	}
-};
-
-struct Frustum
-{
-	Plane topFace;
-	Plane bottomFace;
-
-	Plane rightFace;
-	Plane leftFace;
-
-	Plane farFace;
-	Plane nearFace;
-};
-
 struct BoundingVolume
 {
 	virtual bool isOnFrustum(const Frustum& camFrustum, const Transform& transform) const = 0;
@@ -0,0 +1,77 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+struct Plane
+{
+	glm::vec3 normal = { 0.f, 1.f, 0.f }; // unit vector
+	float     distance = 0.f;        // Distance with origin
+
+	Plane() = default;
+
+	Plane(const glm::vec3& p1, const glm::vec3& norm)
+		: normal(glm::normalize(norm)),
+		distance(glm::dot(normal, p1))
+	{}
+
+	float getSignedDistanceToPlane(const glm::vec3& point) const
+	{
+		return glm::dot(normal, point) - distance;
+	}
+};
+
+struct Frustum
+{
+	Plane topFace;
+	Plane bottomFace;
+
+	Plane rightFace;
+	Plane leftFace;
+
+	Plane farFace;
+	Plane nearFace;
+};
+
+// plane a*x + b*y + c*z + d >= 0 on the inside, normalized
+inline Plane planeFromCoefficients(const glm::vec4& coefficients)
+{
+	float length = glm::length(glm::vec3(coefficients));
+	Plane plane;
+	plane.normal = glm::vec3(coefficients) / length;
+	plane.distance = -coefficients.w / length;
+	return plane;
+}
+
+// Gribb/Hartmann: the six planes straight from a projection * view matrix (GL clip space, -w <= z <= w),
+// normals point inside. Works for any camera that can give its matrices, and for light frustums too
+inline Frustum createFrustumFromMatrix(const glm::mat4& viewProjection)
+{
+	glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+	Frustum frustum;
+	frustum.leftFace = planeFromCoefficients(row3 + row0);
+	frustum.rightFace = planeFromCoefficients(row3 - row0);
+	frustum.bottomFace = planeFromCoefficients(row3 + row1);
+	frustum.topFace = planeFromCoefficients(row3 - row1);
+	frustum.nearFace = planeFromCoefficients(row3 + row2);
+	frustum.farFace = planeFromCoefficients(row3 - row2);
+	return frustum;
+}
+
+// world space center/extents of an object space box under modelMatrix (Arvo 1990), still axis aligned
+inline void transformAABB(const glm::mat4& modelMatrix, const glm::vec3& min, const glm::vec3& max, glm::vec3& outCenter, glm::vec3& outExtents)
+{
+	glm::vec3 center = (min + max) * 0.5f;
+	glm::vec3 extents = (max - min) * 0.5f;
+	outCenter = glm::vec3(modelMatrix * glm::vec4(center, 1.f));
+	for (int i = 0; i < 3; i++)
+		outExtents[i] = std::abs(modelMatrix[0][i]) * extents.x + std::abs(modelMatrix[1][i]) * extents.y + std::abs(modelMatrix[2][i]) * extents.z;
+}
+
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Runtime LOD selection by projected bounding sphere size. Levels come from mesh_simplify.h.
+// A level only changes once the size is HYSTERESIS past the threshold it crossed, so an object sitting right
+// at a threshold doesn't pop back and forth every frame.
+namespace Lod
+{
+    // projected diameter in pixels below which level i is used, level 0 has no lower bound
+    const float THRESHOLDS[] = { 0.0f, 360.0f, 160.0f, 64.0f };
+    const int LEVEL_COUNT = sizeof(THRESHOLDS) / sizeof(THRESHOLDS[0]);
+    const float HYSTERESIS = 0.15f;
+
+    inline bool s_enabled = true;
+    inline glm::vec3 s_cameraPosition = glm::vec3(0.0f);
+    inline float s_pixelsPerUnit = 1.0f;
+
+    // camera of the frame about to be drawn
+    inline void BeginFrame(const glm::vec3& cameraPosition, float fovDegrees, float viewportHeight)
+    {
+        s_cameraPosition = cameraPosition;
+        s_pixelsPerUnit = viewportHeight / (2.0f * std::tan(glm::radians(fovDegrees) * 0.5f));
+    }
+
+    // on screen diameter in pixels of a world space sphere
+    inline float ScreenSize(const glm::vec3& center, float radius)
+    {
+        float distance = glm::length(center - s_cameraPosition);
+        if (distance <= radius)
+            return 1e9f;
+        return 2.0f * radius * s_pixelsPerUnit / distance;
+    }
+
+    // world space bounding sphere of an object space one, scaled by the largest axis of the matrix
+    inline void TransformSphere(const glm::mat4& modelMatrix, const glm::vec3& center, float radius, glm::vec3& outCenter, float& outRadius)
+    {
+        outCenter = glm::vec3(modelMatrix * glm::vec4(center, 1.0f));
+        float scale = std::max(glm::length(glm::vec3(modelMatrix[0])), std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        outRadius = radius * scale;
+    }
+
+    // level for this size given the one used last frame
+    inline int Select(float screenPixels, int current, int levelCount)
+    {
+        if (!s_enabled || levelCount <= 1)
+            return 0;
+
+        int last = std::min(levelCount, LEVEL_COUNT) - 1;
+        current = std::min(std::max(current, 0), last);
+
+        int target = 0;
+        while (target < last && screenPixels < THRESHOLDS[target + 1])
+            target++;
+
+        // coarser only once clearly below the threshold, finer only once clearly above it
+        while (target > current && screenPixels >= THRESHOLDS[target] * (1.0f - HYSTERESIS))
+            target--;
+        while (target < current && screenPixels <= THRESHOLDS[target + 1] * (1.0f + HYSTERESIS))
+            target++;
+        return target;
+    }
+
+    // levels picked last frame for one drawn instance, one per mesh (or a single one for a whole model)
+    struct Selection
+    {
+        std::vector<uint8_t> levels;
+
+        int Update(size_t slot, float screenPixels, int levelCount)
+        {
+            if (levels.size() <= slot)
+                levels.resize(slot + 1, 0);
+            levels[slot] = (uint8_t)Select(screenPixels, levels[slot], levelCount);
+            return levels[slot];
+        }
+    };
+}
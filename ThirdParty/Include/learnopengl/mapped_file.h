@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#undef near
+#undef far
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+            return;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+            return;
+
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping)
+            return;
+
+        m_data = (const unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+        if (m_data)
+            m_size = (size_t)size.QuadPart;
+#else
+        m_fd = open(path.c_str(), O_RDONLY);
+        if (m_fd < 0)
+            return;
+
+        struct stat info;
+        if (fstat(m_fd, &info) != 0 || info.st_size == 0)
+            return;
+
+        void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (data == MAP_FAILED)
+            return;
+
+        m_data = (const unsigned char*)data;
+        m_size = (size_t)info.st_size;
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (m_data)
+            UnmapViewOfFile(m_data);
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE)
+            CloseHandle(m_file);
+#else
+        if (m_data)
+            munmap((void*)m_data, m_size);
+        if (m_fd >= 0)
+            close(m_fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool IsOpen() const { return m_data != nullptr; }
+    const unsigned char* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    const unsigned char* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+// <directory>/<hash as 16 hex digits><extension>, the name of every cooked or cached file
+inline std::string CookedPath(const std::string& directory, uint64_t hash, const std::string& extension)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+    return directory + "/" + name + extension;
+}
+
+// Creates the file's directory and writes it under a temporary name that is renamed into place once complete, so a
+// crash never leaves a truncated file behind. write(std::ostream&) emits the contents; the temporary file is removed
+// again when writing or the rename fails
+template<typename WriteContents>
+inline bool WriteFileAtomically(const std::string& path, WriteContents write)
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+    std::string tempPath = path + ".tmp";
+    bool written;
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        write(out);
+        out.flush();
+        written = (bool)out;
+    }
+
+    if (written)
+        std::filesystem::rename(tempPath, path, error);
+    if (!written || error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+// the common case of a fixed size header followed by one block of data
+template<typename Header, typename T>
+inline bool WriteFileAtomically(const std::string& path, const Header& header, const std::vector<T>& payload)
+{
+    return WriteFileAtomically(path, [&](std::ostream& out) {
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)payload.data(), payload.size() * sizeof(T));
+    });
+}
+
+// FNV-1a over a block of memory
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
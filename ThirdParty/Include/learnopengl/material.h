@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <map>
+
+// The textures of a mesh resolved once when it is uploaded, one per fixed sampler unit, so drawing only binds ids.
+// Meshes using the same textures share one Material; its id is stable for the run and groups them in the RenderQueue sort key
+struct Material
+{
+    // material textures take units 3-8, 0-2 stay free for the IBL maps of the pbr shader
+    static const int FIRST_UNIT = 3;
+    enum Slot
+    {
+        ALBEDO,
+        NORMAL,
+        METALLIC,
+        ROUGHNESS,
+        AO,
+        EMISSIVE,
+        SLOT_COUNT
+    };
+    // sampler uniform of each slot, set once per shader by BindSamplers
+    inline static const char* const SAMPLERS[SLOT_COUNT] = { "albedoMap", "normalMap", "metallicMap", "roughnessMap", "aoMap", "emissiveMap" };
+
+    uint32_t id = 0;
+    std::array<unsigned int, SLOT_COUNT> textures = {};
+    bool useEmissive = false;
+
+    // binds every slot, FIRST_UNIT + slot, and sets the shader's useEmissive flag
+    void Bind(const Shader &shader) const
+    {
+        shader.setBool(shader.useEmissiveLocation, useEmissive);
+        for (int slot = 0; slot < SLOT_COUNT; slot++)
+        {
+            glActiveTexture(GL_TEXTURE0 + FIRST_UNIT + slot);
+            glBindTexture(GL_TEXTURE_2D, textures[slot]);
+        }
+    }
+
+    // points the shader's material samplers at their units and looks up its useEmissive flag, once after the program
+    // is built. samplers it lacks are skipped
+    static void BindSamplers(Shader &shader)
+    {
+        shader.use();
+        shader.useEmissiveLocation = shader.uniform("useEmissive");
+        for (int slot = 0; slot < SLOT_COUNT; slot++)
+        {
+            GLint location = shader.uniform(SAMPLERS[slot]);
+            if (location >= 0)
+                shader.setInt(location, FIRST_UNIT + slot);
+        }
+    }
+};
+
+// Every Material of the run, one per distinct texture set. Filled from Mesh::Upload and emptied by texture deletes, so GL thread only
+class MaterialLibrary
+{
+public:
+    static const Material* Resolve(const std::array<unsigned int, Material::SLOT_COUNT>& textures, bool useEmissive)
+    {
+        std::pair<std::array<unsigned int, Material::SLOT_COUNT>, bool> key(textures, useEmissive);
+        auto it = s_lookup.find(key);
+        if (it != s_lookup.end())
+            return &s_materials[it->second];
+
+        Material material;
+        material.id = static_cast<uint32_t>(s_materials.size());
+        material.textures = textures;
+        material.useEmissive = useEmissive;
+        s_materials.push_back(material);
+        s_lookup.emplace(key, material.id);
+        return &s_materials.back();
+    }
+
+    // called when a texture is deleted: GL may hand its id to a new texture, which must not resolve to the old
+    // materials. They stay in s_materials so ids remain stable, nothing draws with them once their meshes are gone
+    static void Forget(unsigned int texture)
+    {
+        for (auto it = s_lookup.begin(); it != s_lookup.end();)
+        {
+            const std::array<unsigned int, Material::SLOT_COUNT>& textures = it->first.first;
+            if (std::find(textures.begin(), textures.end(), texture) != textures.end())
+                it = s_lookup.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    static const Material& Get(uint32_t id) { return s_materials[id]; }
+    static size_t GetCount() { return s_materials.size(); }
+
+private:
+    // deque so materials never move once handed out
+    inline static std::deque<Material> s_materials;
+    inline static std::map<std::pair<std::array<unsigned int, Material::SLOT_COUNT>, bool>, uint32_t> s_lookup;
+};
@@ -7,7 +7,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <learnopengl/packed_vertex.h>
+#include <learnopengl/material.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 using namespace std;
@@ -43,7 +46,43 @@ public:
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
-    unsigned int VAO;
+    unsigned int VAO = 0;
+    unsigned int vertexCount = 0;
+    unsigned int indexCount = 0;
+
+    // object space bounding box and sphere and the largest UV span, filled in Upload (see RequestTextureDetail in the models)
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
+    float uvExtent = 1.0f;
+
+    // the textures by sampler slot, resolved in Upload once the texture ids are known
+    const Material* material = nullptr;
+
+    // uploads bone ids/weights too (see packed_vertex.h), set by the owning model before Upload
+    bool skinned = false;
+
+    // detail levels as ranges of the one index buffer, [0] is the full mesh (see mesh_simplify.h and lod.h).
+    // empty for meshes without generated levels, indexCount then covers the single level
+    struct LodRange
+    {
+        unsigned int firstIndex;
+        unsigned int indexCount;
+    };
+    static const int MAX_LODS = 4;
+    vector<LodRange> lods;
+
+    // full detail level of static meshes kept on the CPU for the software occlusion rasterizer (see OcclusionCuller)
+    vector<glm::vec3> occluderPositions;
+    vector<unsigned int> occluderIndices;
+
+    // draw calls issued and triangles submitted (instances included) by every mesh since the counters were last reset (see RenderStats)
+    inline static unsigned int s_drawCalls = 0;
+    inline static size_t s_triangles = 0;
+    // vertex buffer bytes uploaded so far, packed and what the float Vertex would have taken (see AssetManager::Report)
+    inline static size_t s_packedVertexBytes = 0;
+    inline static size_t s_floatVertexBytes = 0;
 
     // constructor
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
@@ -51,126 +90,283 @@ public:
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        this->vertexCount = static_cast<unsigned int>(vertices.size());
+        this->indexCount = static_cast<unsigned int>(indices.size());
+    }
 
-        // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+    // mesh whose vertex/index data lives in a mapped cooked file (see cooked_mesh.h). The vertices are already packed
+    // with the stride of GetVertexStride(), the memory is handed to glBufferData as is and no CPU copy is kept
+    Mesh(const void* packedVertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, vector<Texture> textures)
+    {
+        this->textures = textures;
+        this->vertexCount = vertexCount;
+        this->indexCount = indexCount;
+        m_sourcePacked = (const unsigned char*)packedVertices;
+        m_sourceIndices = indices;
     }
 
-    // render the mesh
-    void Draw(Shader &shader) 
-    {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        unsigned int metallicNr = 1;
-        unsigned int roughnessNr = 1;
-
-        unsigned int defaultMap = 0;
-        unsigned int albedoMap = 0;
-        unsigned int normalMap = 0;
-        unsigned int metallicMap = 0;
-        unsigned int roughnessMap = 0;
-        unsigned int aoMap = 0;
-        unsigned int emissiveMap = 0;
- 
-        for (unsigned int i = 0; i < textures.size(); i++)
+    // the float vertices in the GPU layout (see packed_vertex.h), PackedSkinnedVertex or PackedStaticVertex back to back
+    static vector<unsigned char> PackVertices(const Vertex* source, size_t count, bool skinned)
+    {
+        vector<unsigned char> packed(count * (skinned ? sizeof(PackedSkinnedVertex) : sizeof(PackedStaticVertex)));
+        for (size_t i = 0; i < count; i++)
         {
-            string name = textures[i].type;
-
-            if (name == "texture_diffuse")
+            const Vertex& vertex = source[i];
+            PackedStaticVertex base = PackedVertex::PackStatic(vertex.Position, vertex.Normal, vertex.TexCoords, vertex.Tangent, vertex.Bitangent);
+            if (skinned)
             {
-                albedoMap = textures[i].id;
-                defaultMap = textures[i].id;
-            }
-            else if (name == "texture_normal")
-            {
-                normalMap = textures[i].id;
-            }
-            else if (name == "texture_metallic")
-            {
-                metallicMap = textures[i].id;
-
-            }
-            else if (name == "texture_roughness")
-            {
-                roughnessMap = textures[i].id;
-            }
-            else if (name == "texture_ao")
-            {
-                aoMap = textures[i].id;
-            }
-            else if (name == "texture_emissive")
-            {
-                emissiveMap = textures[i].id;
+                PackedSkinnedVertex& out = ((PackedSkinnedVertex*)packed.data())[i];
+                out.Base = base;
+                PackedVertex::PackBones(vertex.m_BoneIDs, vertex.m_Weights, out.BoneIDs, out.Weights);
             }
+            else
+                ((PackedStaticVertex*)packed.data())[i] = base;
+        }
+        return packed;
+    }
 
-            /*
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if (name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-            else if (name == "texture_metallic")
-                number = std::to_string(metallicNr++);
-            else if (name == "texture_roughness")
-                number = std::to_string(roughnessNr++);
-
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
-
-            */
+    // creates the vertex buffers and attribute pointers, GL thread only.
+    // kept apart from the constructor so meshes can be built on a loader thread
+    void Upload()
+    {
+        if (VAO == 0)
+        {
+            computeBounds();
+            setupMesh();
+            if (!skinned)
+                keepOccluder();
+            resolveMaterial();
         }
 
-        albedoMap       = albedoMap != 0    ? albedoMap     : defaultMap;
-        normalMap       = normalMap != 0    ? normalMap     : defaultMap;
-        metallicMap     = metallicMap != 0  ? metallicMap   : defaultMap;
-        roughnessMap    = roughnessMap != 0 ? roughnessMap  : defaultMap;
-        aoMap           = aoMap != 0        ? aoMap         : defaultMap;
-        //emissiveMap     = emissiveMap != 0  ? emissiveMap   : defaultMap;
+        // the mapping is released by the model once everything is uploaded
+        m_sourcePacked = nullptr;
+        m_sourceIndices = nullptr;
+    }
 
-        shader.setBool("useEmissive", emissiveMap != 0);
+    int GetLodCount() const
+    {
+        return lods.empty() ? 1 : static_cast<int>(lods.size());
+    }
 
+    // index range of a detail level, levels past the last one fall back to the coarsest
+    LodRange GetLod(int lod) const
+    {
+        if (lods.empty())
+            return LodRange{ 0, indexCount };
+        return lods[std::clamp(lod, 0, GetLodCount() - 1)];
+    }
+
+    // render the mesh
+    void Draw(Shader &shader, int lod = 0)
+    {
+        if (VAO == 0)
+            return;
+
+        BindTextures(shader);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, albedoMap);
-
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, albedoMap);
-        glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_2D, normalMap);
-        glActiveTexture(GL_TEXTURE5);
-        glBindTexture(GL_TEXTURE_2D, metallicMap);
-        glActiveTexture(GL_TEXTURE6);
-        glBindTexture(GL_TEXTURE_2D, roughnessMap);
-        glActiveTexture(GL_TEXTURE7);
-        glBindTexture(GL_TEXTURE_2D, aoMap);
-        glActiveTexture(GL_TEXTURE8);
-        glBindTexture(GL_TEXTURE_2D, emissiveMap);
-        
         // draw mesh
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        DrawElements(lod);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // render instanceCount copies of the mesh, the caller is responsible for the per-instance attributes on VAO
+    void DrawInstanced(Shader &shader, unsigned int instanceCount, int lod = 0)
+    {
+        if (VAO == 0)
+            return;
+
+        BindTextures(shader);
+
+        glBindVertexArray(VAO);
+        DrawElements(lod, instanceCount);
+        glBindVertexArray(0);
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // only the draw call, VAO and textures must already be bound (the RenderQueue binds them through its state cache)
+    void DrawElements(int lod, unsigned int instanceCount = 1) const
+    {
+        LodRange range = GetLod(lod);
+        if (instanceCount == 1)
+            glDrawElements(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT, (void*)(range.firstIndex * sizeof(unsigned int)));
+        else
+            glDrawElementsInstanced(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT, (void*)(range.firstIndex * sizeof(unsigned int)), instanceCount);
+        s_drawCalls++;
+        s_triangles += (size_t)(range.indexCount / 3) * instanceCount;
+    }
+
+    // Points the per-instance attributes of the bound VAO at offset in the bound GL_ARRAY_BUFFER: the model matrix at
+    // locations 7-10 and, withBoneOffset, the int after it at 11 (see SkinnedBatch). Enabling them and their divisor
+    // is done once per VAO; the state lives here rather than keyed by VAO name because Release frees the name for reuse
+    void PointInstanceAttributes(size_t offset, size_t stride, bool withBoneOffset = false)
+    {
+        int count = withBoneOffset ? 5 : 4;
+        for (int i = m_instanceAttributes; i < count; i++)
+        {
+            glEnableVertexAttribArray(7 + i);
+            glVertexAttribDivisor(7 + i, 1);
+        }
+        m_instanceAttributes = std::max(m_instanceAttributes, count);
+
+        for (int i = 0; i < 4; i++)
+            glVertexAttribPointer(7 + i, 4, GL_FLOAT, GL_FALSE, (GLsizei)stride, (void*)(offset + sizeof(glm::vec4) * i));
+        if (withBoneOffset)
+            glVertexAttribIPointer(11, 1, GL_INT, (GLsizei)stride, (void*)(offset + sizeof(glm::mat4)));
+    }
+
+    // bind the material textures to their fixed sampler units (see material.h)
+    void BindTextures(Shader &shader)
+    {
+        material->Bind(shader);
+    }
+
+    // frees the GL buffers; meshes are copied around inside vector<Mesh>, so this is called by the owning model only
+    void Release()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+        m_instanceAttributes = 0;
+    }
+
+    // vertex and index data as stored on the GPU
+    size_t GetMemoryBytes() const
+    {
+        return vertexCount * GetVertexStride() + indexCount * sizeof(unsigned int);
+    }
+
+    size_t GetVertexStride() const
+    {
+        return skinned ? sizeof(PackedSkinnedVertex) : sizeof(PackedStaticVertex);
+    }
+
+    // copies the packed vertices and every level's indices back from the GL buffers; the CPU side copy is gone once
+    // cooked meshes are uploaded, so this is the way to rebuild geometry from them (see StaticBatch). slow, load time only
+    void ReadBack(vector<uint8_t>& outVertices, vector<unsigned int>& outIndices) const
+    {
+        outVertices.resize(vertexCount * GetVertexStride());
+        outIndices.resize(indexCount);
+        if (VAO == 0)
+            return;
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glGetBufferSubData(GL_ARRAY_BUFFER, 0, outVertices.size(), outVertices.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, outIndices.size() * sizeof(unsigned int), outIndices.data());
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
 private:
     // render data 
-    unsigned int VBO, EBO;
+    unsigned int VBO = 0, EBO = 0;
+    int m_instanceAttributes = 0;	// per-instance attributes enabled on VAO so far, from location 7
+    const unsigned char* m_sourcePacked = nullptr;
+    const unsigned int* m_sourceIndices = nullptr;
+
+    // the skinned layout starts with the static one, so position and uv read the same from both
+    const PackedStaticVertex& sourcePacked(unsigned int i) const
+    {
+        return *(const PackedStaticVertex*)(m_sourcePacked + i * GetVertexStride());
+    }
+
+    glm::vec3 sourcePosition(unsigned int i) const
+    {
+        if (!m_sourcePacked)
+            return vertices[i].Position;
+        const PackedStaticVertex& vertex = sourcePacked(i);
+        return glm::vec3(vertex.Position[0], vertex.Position[1], vertex.Position[2]);
+    }
+
+    glm::vec2 sourceUV(unsigned int i) const
+    {
+        if (!m_sourcePacked)
+            return vertices[i].TexCoords;
+        const PackedStaticVertex& vertex = sourcePacked(i);
+        return glm::vec2(glm::unpackHalf1x16(vertex.TexCoords[0]), glm::unpackHalf1x16(vertex.TexCoords[1]));
+    }
+
+    void computeBounds()
+    {
+        if (vertexCount == 0)
+            return;
+
+        glm::vec3 minPosition = sourcePosition(0), maxPosition = minPosition;
+        glm::vec2 minUV = sourceUV(0), maxUV = minUV;
+        for (unsigned int i = 1; i < vertexCount; i++)
+        {
+            glm::vec3 position = sourcePosition(i);
+            glm::vec2 uv = sourceUV(i);
+            minPosition = glm::min(minPosition, position);
+            maxPosition = glm::max(maxPosition, position);
+            minUV = glm::min(minUV, uv);
+            maxUV = glm::max(maxUV, uv);
+        }
+
+        boundsMin = minPosition;
+        boundsMax = maxPosition;
+        boundsCenter = (minPosition + maxPosition) * 0.5f;
+        boundsRadius = glm::length(maxPosition - boundsCenter);
+        uvExtent = std::max(std::max(maxUV.x - minUV.x, maxUV.y - minUV.y), 1e-3f);
+    }
+
+    // compacted copy of level 0, only the vertices it references. Not a coarser level: the simplifier may push a
+    // silhouette past the real surface, and an occluder that grows hides things that are in view
+    void keepOccluder()
+    {
+        const unsigned int* sourceIndices = m_sourceIndices ? m_sourceIndices : indices.data();
+        LodRange range = GetLod(0);
+
+        const unsigned int UNUSED = ~0u;
+        vector<unsigned int> remap(vertexCount, UNUSED);
+        occluderIndices.resize(range.indexCount);
+        for (unsigned int i = 0; i < range.indexCount; i++)
+        {
+            unsigned int index = sourceIndices[range.firstIndex + i];
+            if (remap[index] == UNUSED)
+            {
+                remap[index] = static_cast<unsigned int>(occluderPositions.size());
+                occluderPositions.push_back(sourcePosition(index));
+            }
+            occluderIndices[i] = remap[index];
+        }
+    }
+
+    // picks the texture of every material slot by its type, missing maps fall back to the diffuse one
+    void resolveMaterial()
+    {
+        std::array<unsigned int, Material::SLOT_COUNT> slots = {};
+        unsigned int emissiveMap = 0;
+        for (const Texture& texture : textures)
+        {
+            if (texture.type == "texture_diffuse")
+                slots[Material::ALBEDO] = texture.id;
+            else if (texture.type == "texture_normal")
+                slots[Material::NORMAL] = texture.id;
+            else if (texture.type == "texture_metallic")
+                slots[Material::METALLIC] = texture.id;
+            else if (texture.type == "texture_roughness")
+                slots[Material::ROUGHNESS] = texture.id;
+            else if (texture.type == "texture_ao")
+                slots[Material::AO] = texture.id;
+            else if (texture.type == "texture_emissive")
+                emissiveMap = texture.id;
+        }
+
+        for (int slot = Material::NORMAL; slot <= Material::AO; slot++)
+            if (slots[slot] == 0)
+                slots[slot] = slots[Material::ALBEDO];
+        slots[Material::EMISSIVE] = emissiveMap;
+
+        material = MaterialLibrary::Resolve(slots, emissiveMap != 0);
+    }
 
     // initializes all the buffer objects/arrays
     void setupMesh()
@@ -181,40 +377,24 @@ private:
         glGenBuffers(1, &EBO);
 
         glBindVertexArray(VAO);
-        // load data into vertex buffers
+        // cooked meshes come packed (see packed_vertex.h), a fresh import packs its float vertices here
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+        if (m_sourcePacked)
+            glBufferData(GL_ARRAY_BUFFER, vertexCount * GetVertexStride(), m_sourcePacked, GL_STATIC_DRAW);
+        else
+        {
+            vector<unsigned char> packed = PackVertices(vertices.data(), vertexCount, skinned);
+            glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+        }
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);	
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);	
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);	
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-		// ids
-		glEnableVertexAttribArray(5);
-		glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-
-		// weights
-		glEnableVertexAttribArray(6);
-		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), m_sourceIndices ? m_sourceIndices : indices.data(), GL_STATIC_DRAW);
+
+        PackedVertex::SetupAttributes(skinned);
         glBindVertexArray(0);
+
+        s_packedVertexBytes += vertexCount * GetVertexStride();
+        s_floatVertexBytes += vertexCount * sizeof(Vertex);
     }
 };
 #endif
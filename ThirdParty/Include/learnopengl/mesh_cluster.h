@@ -0,0 +1,99 @@
+#pragma once
+
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Import time split of large static meshes into spatially compact clusters, so level geometry can be culled
+// piece by piece (see StaticBVH). Each cluster becomes its own Mesh with the source's textures; the rest of the
+// import (MeshOptimizer, MeshSimplify, cooking) then treats it like any other mesh.
+namespace MeshCluster
+{
+    // triangles per cluster at most, small enough that an interior view rejects most of a building
+    const size_t MAX_TRIANGLES = 4096;
+
+    // recursive median split of triangles[first, first + count) on the longest axis of their centroids
+    inline void Partition(const std::vector<glm::vec3>& centroids, std::vector<unsigned int>& triangles, size_t first, size_t count,
+        size_t maxTriangles, std::vector<std::pair<size_t, size_t>>& ranges)
+    {
+        if (count <= maxTriangles)
+        {
+            ranges.push_back({ first, count });
+            return;
+        }
+
+        glm::vec3 minCentroid = centroids[triangles[first]], maxCentroid = minCentroid;
+        for (size_t i = first; i < first + count; i++)
+        {
+            minCentroid = glm::min(minCentroid, centroids[triangles[i]]);
+            maxCentroid = glm::max(maxCentroid, centroids[triangles[i]]);
+        }
+        glm::vec3 size = maxCentroid - minCentroid;
+        int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+
+        size_t half = count / 2;
+        std::nth_element(triangles.begin() + first, triangles.begin() + first + half, triangles.begin() + first + count,
+            [&](unsigned int a, unsigned int b) { return centroids[a][axis] < centroids[b][axis]; });
+
+        Partition(centroids, triangles, first, half, maxTriangles, ranges);
+        Partition(centroids, triangles, first + half, count - half, maxTriangles, ranges);
+    }
+
+    // replaces every mesh over maxTriangles by its clusters, meshes under it are kept as they are
+    inline void Split(std::vector<Mesh>& meshes, const std::string& name, size_t maxTriangles = MAX_TRIANGLES)
+    {
+        std::vector<Mesh> result;
+        for (Mesh& mesh : meshes)
+        {
+            size_t triangleCount = mesh.indices.size() / 3;
+            if (triangleCount <= maxTriangles)
+            {
+                result.push_back(std::move(mesh));
+                continue;
+            }
+
+            std::vector<glm::vec3> centroids(triangleCount);
+            std::vector<unsigned int> triangles(triangleCount);
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                centroids[t] = (mesh.vertices[mesh.indices[t * 3]].Position + mesh.vertices[mesh.indices[t * 3 + 1]].Position
+                    + mesh.vertices[mesh.indices[t * 3 + 2]].Position) / 3.0f;
+                triangles[t] = (unsigned int)t;
+            }
+
+            std::vector<std::pair<size_t, size_t>> ranges;
+            Partition(centroids, triangles, 0, triangleCount, maxTriangles, ranges);
+
+            // each cluster keeps only the vertices it references
+            const unsigned int UNUSED = ~0u;
+            std::vector<unsigned int> remap(mesh.vertices.size(), UNUSED);
+            for (const auto& [first, count] : ranges)
+            {
+                vector<Vertex> vertices;
+                vector<unsigned int> indices;
+                indices.reserve(count * 3);
+                for (size_t i = first; i < first + count; i++)
+                    for (int corner = 0; corner < 3; corner++)
+                    {
+                        unsigned int index = mesh.indices[triangles[i] * 3 + corner];
+                        if (remap[index] == UNUSED)
+                        {
+                            remap[index] = (unsigned int)vertices.size();
+                            vertices.push_back(mesh.vertices[index]);
+                        }
+                        indices.push_back(remap[index]);
+                    }
+                for (unsigned int i = 0; i < indices.size(); i++)
+                    remap[mesh.indices[triangles[first + i / 3] * 3 + i % 3]] = UNUSED;
+
+                result.push_back(Mesh(vertices, indices, mesh.textures));
+            }
+            std::cout << "[MeshCluster] " << name << ": " << triangleCount << " triangles split into " << ranges.size() << " clusters" << std::endl;
+        }
+
+        meshes.swap(result);
+    }
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mapped_file.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Import time index/vertex optimization, run before a mesh is cooked:
+//   1. Weld       merges bit-identical vertices (Assimp emits one vertex per face corner for many formats)
+//   2. Tipsify    reorders triangles for the post-transform vertex cache (Sander et al. 2007)
+//   3. Fetch      renumbers vertices in first-use order so vertex fetch walks memory linearly
+namespace MeshOptimizer
+{
+    // post-transform cache size assumed by Tipsify and the ACMR estimate
+    const unsigned int CACHE_SIZE = 16;
+
+    // average cache miss ratio: transformed vertices per triangle with a FIFO cache, 0.5 is the ideal, 3 the worst
+    inline float ACMR(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize = CACHE_SIZE)
+    {
+        if (indices.size() < 3)
+            return 0.0f;
+
+        // timestamp FIFO: a vertex is in the cache while fewer than cacheSize misses happened since it was loaded
+        std::vector<unsigned int> loadedAt(vertexCount, 0);
+        unsigned int misses = 0;
+        for (unsigned int index : indices)
+        {
+            if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize)
+            {
+                misses++;
+                loadedAt[index] = misses;
+            }
+        }
+        return (float)misses / (float)(indices.size() / 3);
+    }
+
+    struct VertexKey
+    {
+        const Vertex* vertex;
+        bool operator==(const VertexKey& other) const { return memcmp(vertex, other.vertex, sizeof(Vertex)) == 0; }
+    };
+
+    struct VertexKeyHash
+    {
+        size_t operator()(const VertexKey& key) const { return (size_t)HashBytes(key.vertex, sizeof(Vertex)); }
+    };
+
+    // merges bit-identical vertices and rewrites the indices
+    inline void Weld(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+    {
+        std::vector<unsigned int> remap(vertices.size());
+        std::vector<Vertex> welded;
+        welded.reserve(vertices.size());
+
+        std::unordered_map<VertexKey, unsigned int, VertexKeyHash> unique;
+        unique.reserve(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            auto [it, inserted] = unique.emplace(VertexKey{ &vertices[i] }, (unsigned int)welded.size());
+            if (inserted)
+                welded.push_back(vertices[i]);
+            remap[i] = it->second;
+        }
+
+        for (unsigned int& index : indices)
+            index = remap[index];
+        vertices.swap(welded);
+    }
+
+    // Tipsify: fans around the current vertex, then moves to the neighbour most likely still in cache
+    inline void OptimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize = CACHE_SIZE)
+    {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return;
+
+        // triangles adjacent to each vertex
+        std::vector<unsigned int> live(vertexCount, 0);
+        for (unsigned int index : indices)
+            live[index]++;
+
+        std::vector<unsigned int> offsets(vertexCount + 1, 0);
+        for (unsigned int v = 0; v < vertexCount; v++)
+            offsets[v + 1] = offsets[v] + live[v];
+
+        std::vector<unsigned int> adjacency(indices.size());
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++)
+            for (int corner = 0; corner < 3; corner++)
+                adjacency[fill[indices[t * 3 + corner]]++] = (unsigned int)t;
+
+        std::vector<unsigned int> cacheTime(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<unsigned int> deadEnd;
+        std::vector<unsigned int> candidates;
+        std::vector<unsigned int> output;
+        output.reserve(indices.size());
+
+        unsigned int time = cacheSize + 1;
+        unsigned int cursor = 0;
+        int fanning = 0;
+
+        while (fanning >= 0)
+        {
+            candidates.clear();
+            for (unsigned int a = offsets[fanning]; a < offsets[fanning + 1]; a++)
+            {
+                unsigned int t = adjacency[a];
+                if (emitted[t])
+                    continue;
+
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    unsigned int v = indices[t * 3 + corner];
+                    output.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - cacheTime[v] > cacheSize)
+                        cacheTime[v] = time++;
+                }
+                emitted[t] = true;
+            }
+
+            // best candidate still in cache once its remaining triangles are emitted
+            int next = -1;
+            int bestPriority = -1;
+            for (unsigned int v : candidates)
+            {
+                if (live[v] == 0)
+                    continue;
+
+                int priority = 0;
+                if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+                    priority = (int)(time - cacheTime[v]);
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    next = (int)v;
+                }
+            }
+
+            // dead end: most recently used vertex with triangles left, else the next unprocessed one
+            if (next < 0)
+            {
+                while (!deadEnd.empty() && next < 0)
+                {
+                    unsigned int v = deadEnd.back();
+                    deadEnd.pop_back();
+                    if (live[v] > 0)
+                        next = (int)v;
+                }
+                while (next < 0 && cursor < vertexCount)
+                {
+                    if (live[cursor] > 0)
+                        next = (int)cursor;
+                    cursor++;
+                }
+            }
+            fanning = next;
+        }
+
+        indices.swap(output);
+    }
+
+    // renumbers vertices in order of first use, unreferenced vertices are dropped
+    inline void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+    {
+        const unsigned int UNUSED = ~0u;
+        std::vector<unsigned int> remap(vertices.size(), UNUSED);
+        std::vector<Vertex> ordered;
+        ordered.reserve(vertices.size());
+
+        for (unsigned int& index : indices)
+        {
+            if (remap[index] == UNUSED)
+            {
+                remap[index] = (unsigned int)ordered.size();
+                ordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(ordered);
+    }
+
+    // runs the three passes over every mesh of a freshly imported model and logs the result per mesh
+    inline void Optimize(std::vector<Mesh>& meshes, const std::string& name)
+    {
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            Mesh& mesh = meshes[i];
+            size_t vertexCount = mesh.vertices.size();
+            float acmrBefore = ACMR(mesh.indices, (unsigned int)vertexCount);
+
+            Weld(mesh.vertices, mesh.indices);
+            OptimizeVertexCache(mesh.indices, (unsigned int)mesh.vertices.size());
+            OptimizeVertexFetch(mesh.vertices, mesh.indices);
+
+            mesh.vertexCount = (unsigned int)mesh.vertices.size();
+            mesh.indexCount = (unsigned int)mesh.indices.size();
+
+            std::cout << "[MeshOptimizer] " << name << " mesh " << i << ": " << vertexCount << " -> " << mesh.vertexCount
+                << " vertices, ACMR " << acmrBefore << " -> " << ACMR(mesh.indices, mesh.vertexCount) << std::endl;
+        }
+    }
+}
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Import time LOD generation by quadric error edge collapse (Garland & Heckbert 1997).
+// Collapses are half-edge collapses onto an existing vertex, so every level is just another index list over
+// the mesh's one vertex buffer. Vertices on UV/normal seams and open borders never move, which keeps seams from tearing.
+namespace MeshSimplify
+{
+    // fraction of the full triangle count each extra level aims for
+    const float LEVEL_RATIOS[Mesh::MAX_LODS] = { 1.0f, 0.5f, 0.25f, 0.125f };
+    // meshes below this many triangles keep a single level
+    const size_t MIN_TRIANGLES = 64;
+    // largest accepted collapse error, as a fraction of the mesh radius
+    const float MAX_ERROR = 0.05f;
+
+    // symmetric 4x4 plane quadric, upper triangle
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0, a11 = 0, a12 = 0, a13 = 0, a22 = 0, a23 = 0, a33 = 0;
+
+        void AddPlane(double a, double b, double c, double d)
+        {
+            a00 += a * a; a01 += a * b; a02 += a * c; a03 += a * d;
+            a11 += b * b; a12 += b * c; a13 += b * d;
+            a22 += c * c; a23 += c * d;
+            a33 += d * d;
+        }
+
+        Quadric& operator+=(const Quadric& o)
+        {
+            a00 += o.a00; a01 += o.a01; a02 += o.a02; a03 += o.a03;
+            a11 += o.a11; a12 += o.a12; a13 += o.a13;
+            a22 += o.a22; a23 += o.a23;
+            a33 += o.a33;
+            return *this;
+        }
+
+        // sum of squared distances of p to the accumulated planes
+        double Error(const glm::vec3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+                + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+                + a22 * z * z + 2 * a23 * z
+                + a33;
+        }
+    };
+
+    struct Collapse
+    {
+        unsigned int from;
+        unsigned int to;
+        double cost;
+    };
+
+    inline uint64_t EdgeKey(unsigned int a, unsigned int b)
+    {
+        return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+    }
+
+    // Reduces the triangle list towards targetIndexCount indices. Stops early when the next collapse would cost
+    // more than maxError (squared distance), so the result may be larger than asked for
+    inline std::vector<unsigned int> Simplify(const std::vector<Vertex>& vertices, std::vector<unsigned int> indices, size_t targetIndexCount, double maxError)
+    {
+        size_t vertexCount = vertices.size();
+
+        // vertices sharing a position with another vertex sit on a seam and are locked
+        std::vector<bool> locked(vertexCount, false);
+        {
+            std::unordered_map<uint64_t, unsigned int> positions;
+            for (unsigned int v = 0; v < vertexCount; v++)
+            {
+                uint64_t key = HashBytes(&vertices[v].Position, sizeof(glm::vec3));
+                auto [it, inserted] = positions.emplace(key, v);
+                if (!inserted)
+                    locked[v] = locked[it->second] = true;
+            }
+        }
+
+        // so are both ends of an edge used by a single triangle
+        {
+            std::unordered_map<uint64_t, int> edges;
+            for (size_t t = 0; t < indices.size(); t += 3)
+                for (int e = 0; e < 3; e++)
+                    edges[EdgeKey(indices[t + e], indices[t + (e + 1) % 3])]++;
+            for (auto& [key, count] : edges)
+                if (count == 1)
+                    locked[key >> 32] = locked[key & 0xFFFFFFFF] = true;
+        }
+
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t t = 0; t < indices.size(); t += 3)
+        {
+            const glm::vec3& p0 = vertices[indices[t]].Position;
+            glm::vec3 normal = glm::cross(vertices[indices[t + 1]].Position - p0, vertices[indices[t + 2]].Position - p0);
+            float length = glm::length(normal);
+            if (length < 1e-12f)
+                continue;
+
+            normal /= length;
+            for (int corner = 0; corner < 3; corner++)
+                quadrics[indices[t + corner]].AddPlane(normal.x, normal.y, normal.z, -glm::dot(normal, p0));
+        }
+
+        std::vector<unsigned int> remap(vertexCount);
+        std::vector<bool> touched(vertexCount);
+        std::vector<unsigned int> offsets(vertexCount + 1);
+        std::vector<unsigned int> adjacency;
+        std::vector<Collapse> collapses;
+
+        size_t targetTriangles = targetIndexCount / 3;
+        while (indices.size() / 3 > targetTriangles)
+        {
+            size_t triangleCount = indices.size() / 3;
+
+            // triangles around each vertex
+            std::fill(offsets.begin(), offsets.end(), 0);
+            for (unsigned int index : indices)
+                offsets[index + 1]++;
+            for (size_t v = 0; v < vertexCount; v++)
+                offsets[v + 1] += offsets[v];
+            adjacency.resize(indices.size());
+            std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t t = 0; t < triangleCount; t++)
+                for (int corner = 0; corner < 3; corner++)
+                    adjacency[fill[indices[t * 3 + corner]]++] = (unsigned int)t;
+
+            // cheapest direction of every edge
+            collapses.clear();
+            for (size_t t = 0; t < triangleCount; t++)
+                for (int e = 0; e < 3; e++)
+                {
+                    unsigned int a = indices[t * 3 + e], b = indices[t * 3 + (e + 1) % 3];
+                    Quadric merged = quadrics[a];
+                    merged += quadrics[b];
+
+                    double costAB = locked[a] ? 1e300 : merged.Error(vertices[b].Position);
+                    double costBA = locked[b] ? 1e300 : merged.Error(vertices[a].Position);
+                    if (costAB <= costBA && !locked[a])
+                        collapses.push_back({ a, b, costAB });
+                    else if (!locked[b])
+                        collapses.push_back({ b, a, costBA });
+                }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+            for (size_t v = 0; v < vertexCount; v++)
+                remap[v] = (unsigned int)v;
+            std::fill(touched.begin(), touched.end(), false);
+
+            // each collapse removes about two triangles, collapses in one pass never share a neighbourhood
+            size_t removed = 0;
+            size_t applied = 0;
+            for (const Collapse& collapse : collapses)
+            {
+                if (triangleCount - removed <= targetTriangles || collapse.cost > maxError)
+                    break;
+                if (touched[collapse.from] || touched[collapse.to])
+                    continue;
+
+                // reject collapses that flip or squash a remaining triangle
+                bool valid = true;
+                size_t dying = 0;
+                for (unsigned int a = offsets[collapse.from]; a < offsets[collapse.from + 1] && valid; a++)
+                {
+                    const unsigned int* tri = &indices[adjacency[a] * 3];
+                    if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+                    {
+                        dying++;
+                        continue;
+                    }
+
+                    glm::vec3 before[3], after[3];
+                    for (int corner = 0; corner < 3; corner++)
+                    {
+                        before[corner] = vertices[tri[corner]].Position;
+                        after[corner] = tri[corner] == collapse.from ? vertices[collapse.to].Position : before[corner];
+                    }
+                    glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                    glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                    if (glm::dot(normalBefore, normalAfter) <= 0.25f * glm::length(normalBefore) * glm::length(normalAfter) || glm::length(normalAfter) < 1e-12f)
+                        valid = false;
+                }
+                if (!valid)
+                    continue;
+
+                remap[collapse.from] = collapse.to;
+                quadrics[collapse.to] += quadrics[collapse.from];
+                for (unsigned int v : { collapse.from, collapse.to })
+                    for (unsigned int a = offsets[v]; a < offsets[v + 1]; a++)
+                        for (int corner = 0; corner < 3; corner++)
+                            touched[indices[adjacency[a] * 3 + corner]] = true;
+
+                removed += dying;
+                applied++;
+            }
+
+            if (applied == 0)
+                break;
+
+            std::vector<unsigned int> next;
+            next.reserve(indices.size());
+            for (size_t t = 0; t < indices.size(); t += 3)
+            {
+                unsigned int a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+                if (a != b && b != c && a != c)
+                {
+                    next.push_back(a);
+                    next.push_back(b);
+                    next.push_back(c);
+                }
+            }
+            indices.swap(next);
+        }
+
+        return indices;
+    }
+
+    // appends up to MAX_LODS - 1 simplified index lists to every mesh and records their ranges in Mesh::lods
+    inline void GenerateLods(std::vector<Mesh>& meshes, const std::string& name)
+    {
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            Mesh& mesh = meshes[i];
+            size_t fullIndexCount = mesh.indices.size();
+            mesh.lods.clear();
+            mesh.lods.push_back(Mesh::LodRange{ 0, (unsigned int)fullIndexCount });
+            if (fullIndexCount / 3 < MIN_TRIANGLES)
+                continue;
+
+            glm::vec3 minPosition = mesh.vertices[0].Position, maxPosition = minPosition;
+            for (const Vertex& vertex : mesh.vertices)
+            {
+                minPosition = glm::min(minPosition, vertex.Position);
+                maxPosition = glm::max(maxPosition, vertex.Position);
+            }
+            double maxError = MAX_ERROR * glm::length(maxPosition - minPosition) * 0.5;
+            maxError *= maxError;
+
+            std::vector<unsigned int> all = mesh.indices;
+            std::vector<unsigned int> previous = mesh.indices;
+            for (int level = 1; level < Mesh::MAX_LODS; level++)
+            {
+                size_t target = (size_t)(fullIndexCount * LEVEL_RATIOS[level]) / 3 * 3;
+                std::vector<unsigned int> simplified = Simplify(mesh.vertices, previous, target, maxError);
+
+                // not worth a level when it saves under a tenth of the previous one
+                if (simplified.empty() || simplified.size() > previous.size() * 9 / 10)
+                    break;
+
+                MeshOptimizer::OptimizeVertexCache(simplified, (unsigned int)mesh.vertices.size());
+                mesh.lods.push_back(Mesh::LodRange{ (unsigned int)all.size(), (unsigned int)simplified.size() });
+                all.insert(all.end(), simplified.begin(), simplified.end());
+                previous.swap(simplified);
+            }
+
+            mesh.indices.swap(all);
+            mesh.indexCount = (unsigned int)mesh.indices.size();
+
+            std::cout << "[MeshSimplify] " << name << " mesh " << i << ": triangles";
+            for (const Mesh::LodRange& lod : mesh.lods)
+                std::cout << " " << lod.indexCount / 3;
+            std::cout << std::endl;
+        }
+    }
+}
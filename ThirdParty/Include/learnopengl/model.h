@@ -10,13 +10,23 @@
 #include <assimp/postprocess.h>
 
 #include <learnopengl/mesh.h>
+#include <learnopengl/texture_cache.h>
+#include <learnopengl/model_textures.h>
+#include <learnopengl/cooked_mesh.h>
+#include <learnopengl/mesh_cluster.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/mesh_simplify.h>
+#include <learnopengl/lod.h>
 #include <learnopengl/shader.h>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <chrono>
 #include <map>
+#include <unordered_map>
+#include <memory>
 #include <vector>
 using namespace std;
 
@@ -30,24 +40,126 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // object space box around every mesh, filled in Upload (see FrustumCuller)
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
 
     // constructor, expects a filepath to a 3D model.
     Model_Static(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    {
+        Parse(path);
+        Upload();
+    }
+
+    // models own their GL objects, share them through AssetManager handles instead of copying
+    Model_Static(const Model_Static&) = delete;
+    Model_Static& operator=(const Model_Static&) = delete;
+
+    // empty model to be filled by Parse/Upload, used by the asset loader
+    Model_Static() : gammaCorrection(false) {}
+
+    // CPU stage: Assimp import, vertex extraction and image decode. Safe on a loader thread
+    void Parse(string const &path)
     {
         loadModel(path);
     }
 
+    // GL stage: creates the textures and mesh buffers, GL thread only
+    void Upload()
+    {
+        m_textures.Upload(textures_loaded, meshes);
+        for (Mesh& mesh : meshes)
+            mesh.Upload();
+
+        if (!meshes.empty())
+        {
+            boundsMin = meshes[0].boundsMin;
+            boundsMax = meshes[0].boundsMax;
+            for (const Mesh& mesh : meshes)
+            {
+                boundsMin = glm::min(boundsMin, mesh.boundsMin);
+                boundsMax = glm::max(boundsMax, mesh.boundsMax);
+            }
+        }
+        m_cookedFile.reset();
+        m_uploaded = true;
+    }
+
+    bool IsUploaded() const { return m_uploaded; }
+
+    // tells the texture streamer how large each mesh shows up on screen (see ModelTextures::RequestDetail)
+    void RequestTextureDetail(const glm::mat4& modelMatrix, const glm::vec3& cameraPosition, float pixelsPerUnit, uint64_t frame)
+    {
+        m_textures.RequestDetail(meshes, modelMatrix, cameraPosition, pixelsPerUnit, frame);
+    }
+
+    ~Model_Static()
+    {
+        for (Mesh& mesh : meshes)
+            mesh.Release();
+    }
+
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
+
+    // draws every mesh at the detail level its screen size asks for, selection keeps the levels of this instance between frames
+    void Draw(Shader &shader, const glm::mat4& modelMatrix, Lod::Selection& selection)
+    {
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            DrawMesh(shader, i, modelMatrix, selection);
+    }
+
+    // same for a subset of the meshes, e.g. the ones a StaticBVH found visible
+    void Draw(Shader &shader, const glm::mat4& modelMatrix, Lod::Selection& selection, const vector<unsigned int>& meshIndices)
+    {
+        for (unsigned int i : meshIndices)
+            DrawMesh(shader, i, modelMatrix, selection);
+    }
+
+    void DrawMesh(Shader &shader, unsigned int i, const glm::mat4& modelMatrix, Lod::Selection& selection)
+    {
+        meshes[i].Draw(shader, SelectLod(i, modelMatrix, selection));
+    }
+
+    // detail level mesh i needs at its size on screen this frame
+    int SelectLod(unsigned int i, const glm::mat4& modelMatrix, Lod::Selection& selection)
+    {
+        glm::vec3 center;
+        float radius;
+        Lod::TransformSphere(modelMatrix, meshes[i].boundsCenter, meshes[i].boundsRadius, center, radius);
+        return selection.Update(i, Lod::ScreenSize(center, radius), meshes[i].GetLodCount());
+    }
     
 private:
+    ModelTextures m_textures;	// textures_loaded and each mesh's share of them, held through the TextureCache
+    bool m_uploaded = false;
+    std::unique_ptr<MappedFile> m_cookedFile;	// backs the meshes' vertex data until Upload
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+
+        // a cooked copy of this exact source skips the Assimp import
+        auto start = std::chrono::high_resolution_clock::now();
+        uint64_t hash = CookedMesh::SourceHash(path, 'S');
+        string cookedPath = CookedMesh::CookedPath(hash);
+        float importMs = 0.0f;
+        if (hash && (m_cookedFile = CookedMesh::Read(cookedPath, hash, false, meshes, nullptr, nullptr, &importMs)))
+        {
+            for (const Mesh& mesh : meshes)
+                for (const Texture& texture : mesh.textures)
+                    acquireTexture(texture);
+            cout << "[CookedMesh] " << path << ": " << std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count()
+                << " ms from " << cookedPath << " (Assimp import took " << importMs << " ms)" << endl;
+            return;
+        }
+
         // read file via ASSIMP
         Assimp::Importer importer;
         const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
@@ -57,11 +169,17 @@ private:
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
             return;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
 
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
+        // cooked files are written after this, so clustering, optimization and LOD generation are paid once per source
+        MeshCluster::Split(meshes, path);
+        MeshOptimizer::Optimize(meshes, path);
+        MeshSimplify::GenerateLods(meshes, path);
+
+        importMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        if (hash && CookedMesh::Write(cookedPath, hash, importMs, false, meshes, nullptr, 0))
+            cout << "[CookedMesh] " << path << ": imported in " << importMs << " ms, cooked to " << cookedPath << endl;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -93,7 +211,7 @@ private:
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            Vertex vertex;
+            Vertex vertex = {};   // zeroed, the optimizer welds vertices bytewise
             glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
             // positions
             vector.x = mesh->mVertices[i].x;
@@ -167,6 +285,13 @@ private:
         return Mesh(vertices, indices, textures);
     }
 
+    // adds the texture to textures_loaded on its first use in this model, decoding goes through the shared TextureCache
+    void acquireTexture(const Texture& texture)
+    {
+        if (m_textures.Acquire(this->directory, texture))
+            textures_loaded.push_back(texture);
+    }
+
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
     // the required info is returned as a Texture struct.
     vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
@@ -176,68 +301,20 @@ private:
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
-            }
+            Texture texture;
+            texture.id = 0; // set in Upload
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
+            acquireTexture(texture);
         }
         return textures;
     }
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+inline unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
 {
-    string filename = string(path);
-    filename = directory + '/' + filename;
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    ImageData image = DecodeImage(directory + '/' + string(path));
+    return UploadImage(image);
 }
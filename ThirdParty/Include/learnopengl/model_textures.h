@@ -0,0 +1,81 @@
+#pragma once
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/texture_cache.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The material textures of one model (Model_Static or Model_Bone): a reference into the shared TextureCache per
+// texture the model uses, and per mesh the ones it draws with, which is what the texture streamer is asked about.
+class ModelTextures
+{
+public:
+    // takes a reference on the texture's first use in this model, returns false when it already had one
+    bool Acquire(const std::string& directory, const Texture& texture)
+    {
+        std::shared_ptr<CachedTexture>& cached = m_refs[Key(texture)];
+        if (cached)
+            return false;
+
+        cached = TextureCache::Acquire(directory + '/' + texture.path, GetUsage(texture));
+        return true;
+    }
+
+    // creates the GL textures and points every mesh's textures at them, GL thread only
+    void Upload(std::vector<Texture>& loaded, std::vector<Mesh>& meshes)
+    {
+        for (Texture& texture : loaded)
+            texture.id = m_refs[Key(texture)]->Upload();
+
+        m_meshRefs.clear();
+        for (Mesh& mesh : meshes)
+        {
+            m_meshRefs.emplace_back();
+            for (Texture& texture : mesh.textures)
+            {
+                CachedTexture* cached = m_refs[Key(texture)].get();
+                texture.id = cached->id;
+                m_meshRefs.back().push_back(cached);
+            }
+        }
+    }
+
+    // tells the texture streamer how large each mesh shows up on screen, so its textures keep enough mip levels.
+    // pixelsPerUnit is the screen height in pixels of one world unit at distance 1
+    void RequestDetail(const std::vector<Mesh>& meshes, const glm::mat4& modelMatrix, const glm::vec3& cameraPosition, float pixelsPerUnit, uint64_t frame)
+    {
+        float scale = std::max(std::max(glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1]))), glm::length(glm::vec3(modelMatrix[2])));
+        for (size_t i = 0; i < m_meshRefs.size(); i++)
+        {
+            const Mesh& mesh = meshes[i];
+            glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(mesh.boundsCenter, 1.0f));
+            float radius = mesh.boundsRadius * scale;
+            float distance = std::max(glm::length(center - cameraPosition) - radius, 0.01f);
+            float pixelsPerUV = 2.0f * radius * pixelsPerUnit / distance / mesh.uvExtent;
+            for (CachedTexture* texture : m_meshRefs[i])
+                texture->RequestDetail(pixelsPerUV, frame);
+        }
+    }
+
+private:
+    // normal maps only keep x/y so they cook to BC5, the shaders rebuild z
+    static CookedTexture::Usage GetUsage(const Texture& texture)
+    {
+        return texture.type == "texture_normal" ? CookedTexture::Usage::Normal : CookedTexture::Usage::Color;
+    }
+
+    // the same file as a color and as a normal map are two textures, like in the TextureCache
+    static std::string Key(const Texture& texture)
+    {
+        return (GetUsage(texture) == CookedTexture::Usage::Normal ? "n:" : "c:") + texture.path;
+    }
+
+    std::unordered_map<std::string, std::shared_ptr<CachedTexture>> m_refs;
+    std::vector<std::vector<CachedTexture*>> m_meshRefs;
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// GPU side vertex layouts. Meshes are imported as the float Vertex in mesh.h and packed when cooked (see cooked_mesh.h):
+//   location 0  position        3 x float
+//   location 1  normal          2 x snorm16, octahedral
+//   location 2  uv              2 x half float
+//   location 3  tangent         4 x snorm8, octahedral xy + bitangent sign in z (bitangent = cross(N, T) * sign)
+//   location 5  bone ids        4 x uint8, 255 = unused      (skinned only)
+//   location 6  bone weights    4 x unorm8, summing to 255   (skinned only)
+// 24 bytes static and 32 bytes skinned, against 88 for Vertex. The shaders decode with decodeOct().
+struct PackedStaticVertex
+{
+    float Position[3];
+    int16_t Normal[2];
+    uint16_t TexCoords[2];
+    int8_t Tangent[4];
+};
+
+struct PackedSkinnedVertex
+{
+    PackedStaticVertex Base;
+    uint8_t BoneIDs[4];
+    uint8_t Weights[4];
+};
+
+namespace PackedVertex
+{
+    const uint8_t NO_BONE = 255;
+
+    // unit vector to the [-1, 1] square of its octahedral projection
+    inline glm::vec2 EncodeOct(glm::vec3 n)
+    {
+        float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if (length < 1e-8f)
+            return glm::vec2(0.0f, 0.0f);
+
+        n /= length;
+        glm::vec2 oct(n.x, n.y);
+        if (n.z < 0.0f)
+            oct = (1.0f - glm::abs(glm::vec2(oct.y, oct.x))) * glm::vec2(oct.x >= 0.0f ? 1.0f : -1.0f, oct.y >= 0.0f ? 1.0f : -1.0f);
+        return oct;
+    }
+
+    inline glm::vec3 DecodeOct(glm::vec2 oct)
+    {
+        glm::vec3 n(oct.x, oct.y, 1.0f - std::abs(oct.x) - std::abs(oct.y));
+        float t = std::max(-n.z, 0.0f);
+        n.x += n.x >= 0.0f ? -t : t;
+        n.y += n.y >= 0.0f ? -t : t;
+        return glm::normalize(n);
+    }
+
+    inline int16_t ToSnorm16(float value)
+    {
+        return (int16_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+    }
+
+    inline int8_t ToSnorm8(float value)
+    {
+        return (int8_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 127.0f);
+    }
+
+    inline PackedStaticVertex PackStatic(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv,
+        const glm::vec3& tangent, const glm::vec3& bitangent)
+    {
+        PackedStaticVertex packed;
+        packed.Position[0] = position.x;
+        packed.Position[1] = position.y;
+        packed.Position[2] = position.z;
+
+        glm::vec2 normalOct = EncodeOct(normal);
+        packed.Normal[0] = ToSnorm16(normalOct.x);
+        packed.Normal[1] = ToSnorm16(normalOct.y);
+
+        packed.TexCoords[0] = glm::packHalf1x16(uv.x);
+        packed.TexCoords[1] = glm::packHalf1x16(uv.y);
+
+        // only the handedness of the bitangent is kept
+        glm::vec2 tangentOct = EncodeOct(tangent);
+        float handedness = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+        packed.Tangent[0] = ToSnorm8(tangentOct.x);
+        packed.Tangent[1] = ToSnorm8(tangentOct.y);
+        packed.Tangent[2] = ToSnorm8(handedness);
+        packed.Tangent[3] = 0;
+        return packed;
+    }
+
+    // the vertex moved by modelMatrix, normal and tangent through normalMatrix (inverse transpose of its upper 3x3).
+    // a mirroring matrix flips the bitangent sign so the tangent frame keeps its handedness
+    inline PackedStaticVertex TransformStatic(const PackedStaticVertex& vertex, const glm::mat4& modelMatrix, const glm::mat3& normalMatrix)
+    {
+        PackedStaticVertex packed = vertex;
+        glm::vec3 position = glm::vec3(modelMatrix * glm::vec4(vertex.Position[0], vertex.Position[1], vertex.Position[2], 1.0f));
+        packed.Position[0] = position.x;
+        packed.Position[1] = position.y;
+        packed.Position[2] = position.z;
+
+        glm::vec3 normal = DecodeOct(glm::vec2(vertex.Normal[0], vertex.Normal[1]) / 32767.0f);
+        glm::vec2 normalOct = EncodeOct(glm::normalize(normalMatrix * normal));
+        packed.Normal[0] = ToSnorm16(normalOct.x);
+        packed.Normal[1] = ToSnorm16(normalOct.y);
+
+        glm::vec3 tangent = DecodeOct(glm::vec2(vertex.Tangent[0], vertex.Tangent[1]) / 127.0f);
+        glm::vec2 tangentOct = EncodeOct(glm::normalize(glm::mat3(modelMatrix) * tangent));
+        packed.Tangent[0] = ToSnorm8(tangentOct.x);
+        packed.Tangent[1] = ToSnorm8(tangentOct.y);
+        if (glm::determinant(glm::mat3(modelMatrix)) < 0.0f)
+            packed.Tangent[2] = (int8_t)-vertex.Tangent[2];
+        return packed;
+    }
+
+    // bone ids outside 0..254 are dropped, weights are requantized so they still sum to one
+    inline void PackBones(const int boneIDs[4], const float weights[4], uint8_t outIDs[4], uint8_t outWeights[4])
+    {
+        float total = 0.0f;
+        for (int i = 0; i < 4; i++)
+            if (boneIDs[i] >= 0 && boneIDs[i] < NO_BONE)
+                total += weights[i];
+
+        int sum = 0, largest = -1;
+        for (int i = 0; i < 4; i++)
+        {
+            bool used = boneIDs[i] >= 0 && boneIDs[i] < NO_BONE && total > 0.0f;
+            outIDs[i] = used ? (uint8_t)boneIDs[i] : NO_BONE;
+            outWeights[i] = used ? (uint8_t)std::lround(weights[i] / total * 255.0f) : 0;
+            sum += outWeights[i];
+            if (used && (largest < 0 || outWeights[i] > outWeights[largest]))
+                largest = i;
+        }
+
+        // rounding error goes to the strongest influence
+        if (largest >= 0)
+            outWeights[largest] = (uint8_t)std::clamp(outWeights[largest] + 255 - sum, 0, 255);
+    }
+
+    // attribute pointers for the bound VAO/VBO
+    inline void SetupAttributes(bool skinned)
+    {
+        GLsizei stride = skinned ? sizeof(PackedSkinnedVertex) : sizeof(PackedStaticVertex);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedStaticVertex, Position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedStaticVertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedStaticVertex, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_BYTE, GL_TRUE, stride, (void*)offsetof(PackedStaticVertex, Tangent));
+
+        if (skinned)
+        {
+            glEnableVertexAttribArray(5);
+            glVertexAttribIPointer(5, 4, GL_UNSIGNED_BYTE, stride, (void*)offsetof(PackedSkinnedVertex, BoneIDs));
+            glEnableVertexAttribArray(6);
+            glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(PackedSkinnedVertex, Weights));
+        }
+    }
+}
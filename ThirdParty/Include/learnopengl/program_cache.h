@@ -0,0 +1,160 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <learnopengl/mapped_file.h>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Linked shader programs saved with glGetProgramBinary after their first link and handed to glProgramBinary on
+// later runs, so Shader skips compiling and linking from source.
+//
+// A binary is keyed by the shader sources and the driver's vendor/renderer/version strings: an edited shader or a
+// driver update just misses and links from source again, as does a binary the driver refuses. Needs the entry points
+// of GL 4.1 (GL_ARB_get_program_binary) and at least one binary format, without them every program links from source.
+namespace ProgramCache
+{
+    const uint32_t MAGIC = 0x47525042; // "BPRG"
+    const uint32_t VERSION = 1;
+    const char* const DIRECTORY = "Assets/Cooked/Programs";
+
+    inline bool s_enabled = true;
+
+    // programs linked from source and programs loaded from binaries, with the time spent on each
+    inline int s_linked = 0;
+    inline int s_loaded = 0;
+    inline double s_linkMs = 0.0;
+    inline double s_loadMs = 0.0;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t size;
+    };
+
+    inline bool IsSupported()
+    {
+        static const bool supported = []() {
+            if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri)
+                return false;
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            return formats > 0;
+        }();
+        return s_enabled && supported;
+    }
+
+    inline uint64_t DriverHash()
+    {
+        static const uint64_t hash = []() {
+            uint64_t driver = HashBytes(&VERSION, sizeof(VERSION));
+            for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+            {
+                const char* value = (const char*)glGetString(name);
+                if (value)
+                    driver = HashBytes(value, std::char_traits<char>::length(value), driver);
+            }
+            return driver;
+        }();
+        return hash;
+    }
+
+    // the sources of every stage in order, an empty one for a stage the program doesn't have
+    inline uint64_t Key(std::initializer_list<std::string_view> sources)
+    {
+        uint64_t hash = DriverHash();
+        for (std::string_view source : sources)
+        {
+            uint64_t length = source.size();
+            hash = HashBytes(&length, sizeof(length), hash);
+            hash = HashBytes(source.data(), source.size(), hash);
+        }
+        return hash;
+    }
+
+    inline std::string BinaryPath(uint64_t key)
+    {
+        return CookedPath(DIRECTORY, key, ".bprog");
+    }
+
+    inline double MsSince(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // loads the binary saved for key into the (empty) program. false when there is none or the driver rejects it,
+    // the program is then linked from source as usual
+    inline bool Load(GLuint program, uint64_t key, std::chrono::high_resolution_clock::time_point start)
+    {
+        if (!IsSupported())
+            return false;
+
+        std::ifstream in(BinaryPath(key), std::ios::binary);
+        Header header = {};
+        if (!in || !in.read((char*)&header, sizeof(header)) || header.magic != MAGIC || header.version != VERSION || header.key != key)
+            return false;
+
+        std::vector<char> binary(header.size);
+        if (!in.read(binary.data(), binary.size()))
+            return false;
+
+        glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+            return false;
+
+        s_loaded++;
+        s_loadMs += MsSince(start);
+        return true;
+    }
+
+    // before glLinkProgram, so the driver keeps the binary around for Save
+    inline void PrepareLink(GLuint program)
+    {
+        if (IsSupported())
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // after a link from source: records its time and writes the binary for the next run
+    inline void Save(GLuint program, uint64_t key, std::chrono::high_resolution_clock::time_point start)
+    {
+        s_linked++;
+        s_linkMs += MsSince(start);
+
+        GLint linked = GL_FALSE, length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!IsSupported() || !linked)
+            return;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+
+        Header header = { MAGIC, VERSION, key, 0, 0 };
+        std::vector<char> binary(length);
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &header.format, binary.data());
+        header.size = (uint32_t)written;
+        binary.resize(header.size);
+
+        if (!WriteFileAtomically(BinaryPath(key), header, binary))
+            std::cout << "[Shaders] could not save the program binary " << BinaryPath(key) << std::endl;
+    }
+
+    inline void Report()
+    {
+        std::cout << "[Shaders] " << s_linked << " programs linked from source in " << s_linkMs << " ms, "
+            << s_loaded << " loaded from binaries in " << s_loadMs << " ms"
+            << (IsSupported() ? "" : " (program binaries unavailable)") << std::endl;
+    }
+}
@@ -4,19 +4,28 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <learnopengl/program_cache.h>
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
 
 class Shader
 {
 public:
     unsigned int ID;
+    // location of the material's useEmissive flag, looked up once by Material::BindSamplers so Material::Bind can set it per draw
+    GLint useEmissiveLocation = -1;
+    // glUniform* calls and glGetUniformLocation lookups made through every Shader since the counters were last reset (see RenderStats)
+    inline static size_t s_uniformCalls = 0;
+    inline static size_t s_locationLookups = 0;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
     {
+        auto start = std::chrono::high_resolution_clock::now();
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
         std::string fragmentCode;
@@ -57,9 +66,14 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
+        // 2. a binary of this exact program saved by an earlier run skips compiling (see program_cache.h)
+        uint64_t cacheKey = ProgramCache::Key({ vertexCode, fragmentCode, geometryCode });
+        ID = glCreateProgram();
+        if (ProgramCache::Load(ID, cacheKey, start))
+            return;
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
+        // 3. compile shaders
         unsigned int vertex, fragment;
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
@@ -82,11 +96,11 @@ public:
             checkCompileErrors(geometry, "GEOMETRY");
         }
         // shader Program
-        ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
         if(geometryPath != nullptr)
             glAttachShader(ID, geometry);
+        ProgramCache::PrepareLink(ID);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
         // delete the shaders as they're linked into our program now and no longer necessary
@@ -94,6 +108,7 @@ public:
         glDeleteShader(fragment);
         if(geometryPath != nullptr)
             glDeleteShader(geometry);
+        ProgramCache::Save(ID, cacheKey, start);
 
     }
     // activate the shader
@@ -105,63 +120,152 @@ public:
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
-    {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+    {
+        setBool(uniform(name), value);
+    }
+    void setBool(GLint location, bool value) const
+    {
+        s_uniformCalls++;
+        glUniform1i(location, (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
-    { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+    {
+        setInt(uniform(name), value);
+    }
+    void setInt(GLint location, int value) const
+    {
+        s_uniformCalls++;
+        glUniform1i(location, value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
-    { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    {
+        setFloat(uniform(name), value);
+    }
+    void setFloat(GLint location, float value) const
+    {
+        s_uniformCalls++;
+        glUniform1f(location, value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
-    { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    {
+        setVec2(uniform(name), value);
+    }
+    void setVec2(GLint location, const glm::vec2 &value) const
+    {
+        s_uniformCalls++;
+        glUniform2fv(location, 1, &value[0]);
     }
     void setVec2(const std::string &name, float x, float y) const
-    { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+    {
+        setVec2(uniform(name), x, y);
+    }
+    void setVec2(GLint location, float x, float y) const
+    {
+        s_uniformCalls++;
+        glUniform2f(location, x, y);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
-    { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    {
+        setVec3(uniform(name), value);
+    }
+    void setVec3(GLint location, const glm::vec3 &value) const
+    {
+        s_uniformCalls++;
+        glUniform3fv(location, 1, &value[0]);
     }
     void setVec3(const std::string &name, float x, float y, float z) const
-    { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+    {
+        setVec3(uniform(name), x, y, z);
+    }
+    void setVec3(GLint location, float x, float y, float z) const
+    {
+        s_uniformCalls++;
+        glUniform3f(location, x, y, z);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
-    { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    {
+        setVec4(uniform(name), value);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) 
-    { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+    void setVec4(GLint location, const glm::vec4 &value) const
+    {
+        s_uniformCalls++;
+        glUniform4fv(location, 1, &value[0]);
+    }
+    void setVec4(const std::string &name, float x, float y, float z, float w) const
+    {
+        setVec4(uniform(name), x, y, z, w);
+    }
+    void setVec4(GLint location, float x, float y, float z, float w) const
+    {
+        s_uniformCalls++;
+        glUniform4f(location, x, y, z, w);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat2(uniform(name), mat);
+    }
+    void setMat2(GLint location, const glm::mat2 &mat) const
+    {
+        s_uniformCalls++;
+        glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat3(uniform(name), mat);
+    }
+    void setMat3(GLint location, const glm::mat3 &mat) const
+    {
+        s_uniformCalls++;
+        glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat4(uniform(name), mat);
+    }
+    void setMat4(GLint location, const glm::mat4 &mat) const
+    {
+        s_uniformCalls++;
+        glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    // several matrices of a uniform array at once, location of element 0
+    void setMat4Array(GLint location, const glm::mat4 *mats, int count) const
+    {
+        s_uniformCalls++;
+        glUniformMatrix4fv(location, count, GL_FALSE, &mats[0][0][0]);
+    }
+    // ------------------------------------------------------------------------
+    // location of a uniform, resolved with glGetUniformLocation the first time only.
+    // hot paths keep the result and use the GLint setters
+    GLint uniform(const std::string &name) const
+    {
+        auto it = m_uniformLocations.find(name);
+        if (it != m_uniformLocations.end())
+            return it->second;
+        s_locationLookups++;
+        GLint location = glGetUniformLocation(ID, name.c_str());
+        m_uniformLocations.emplace(name, location);
+        return location;
+    }
+    // ------------------------------------------------------------------------
+    // binds the named uniform block to a binding point, programs without the block are left alone
+    void bindUniformBlock(const char *name, GLuint binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(ID, name);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
     }
 
 private:
+    mutable std::unordered_map<std::string, GLint> m_uniformLocations;
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
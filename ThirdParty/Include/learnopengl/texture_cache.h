@@ -0,0 +1,285 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/cooked_texture.h>
+#include <learnopengl/material.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One decoded/uploaded texture shared by every model that references the same file
+struct CachedTexture
+{
+    std::string path;
+    unsigned int id = 0;
+    size_t bytes = 0;
+    size_t sourceBytes = 0;     // uncompressed size with driver generated mips, what a raw upload costs
+    float loadMs = 0.0f;        // decode, or map of the cooked file
+    float sourceMs = 0.0f;      // stb decode time of the source
+    const char* format = "raw";
+
+    // Mip streaming state (see TextureStreamer), main thread only. Only cooked textures stream: levels
+    // finer than residentLevel are undefined in GL and GL_TEXTURE_BASE_LEVEL points at residentLevel
+    bool streamable = false;
+    bool streaming = false;         // a level is on its way in
+    uint32_t mipCount = 1;
+    uint32_t residentLevel = 0;     // finest level on the GPU
+    uint32_t minimumLevel = 0;      // the coarse tail uploaded up front, never evicted
+    uint32_t wantedLevel = 0;       // finest level asked for by the draws of the last used frame
+    uint64_t lastUsedFrame = 0;
+
+    // largest side of the up-front mips when streaming, 0 uploads the whole chain
+    inline static uint32_t s_streamInitialSize = 0;
+
+    // creates the GL texture on first use, GL thread only
+    unsigned int Upload()
+    {
+        if (id == 0)
+        {
+            auto uploadBegin = std::chrono::high_resolution_clock::now();
+            if (cooked)
+            {
+                mipCount = CookedTexture::GetHeader(*cooked).mipCount;
+                uint32_t baseLevel = s_streamInitialSize ? CookedTexture::FirstLevelWithin(*cooked, s_streamInitialSize) : 0;
+                id = CookedTexture::Upload(*cooked, baseLevel, &bytes);
+                residentLevel = minimumLevel = wantedLevel = baseLevel;
+
+                // the mapping stays around while finer levels can still be streamed in
+                streamable = baseLevel > 0;
+                if (!streamable)
+                    cooked.reset();
+            }
+            else
+            {
+                bytes = (size_t)image.width * image.height * std::max(image.components, 1) * 4 / 3;
+                sourceBytes = bytes;
+                id = UploadImage(image);
+            }
+            loadMs += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - uploadBegin).count();
+        }
+        return id;
+    }
+
+    // asks for enough detail to cover pixelsPerUV screen pixels per unit of texture coordinate
+    void RequestDetail(float pixelsPerUV, uint64_t frame)
+    {
+        if (!streamable)
+            return;
+
+        const CookedTexture::Level& top = CookedTexture::GetLevel(*cooked, 0);
+        float texels = (float)std::max(top.width, top.height);
+        float level = std::log2(texels / std::max(pixelsPerUV, 1.0f));
+        uint32_t wanted = (uint32_t)std::clamp((int)std::floor(level), 0, (int)minimumLevel);
+
+        if (lastUsedFrame != frame)
+            wantedLevel = wanted;
+        else
+            wantedLevel = std::min(wantedLevel, wanted);
+        lastUsedFrame = frame;
+    }
+
+    size_t LevelBytes(uint32_t level) const
+    {
+        return (size_t)CookedTexture::GetLevel(*cooked, level).size;
+    }
+
+    // copy of one level out of the mapping, faulting its pages in. Safe on a loader thread
+    std::vector<unsigned char> ReadLevel(uint32_t level) const
+    {
+        const CookedTexture::Level& entry = CookedTexture::GetLevel(*cooked, level);
+        const unsigned char* data = cooked->Data() + entry.offset;
+        return std::vector<unsigned char>(data, data + entry.size);
+    }
+
+    // uploads the level just above residentLevel, GL thread only
+    void StreamIn(uint32_t level, const unsigned char* data)
+    {
+        const CookedTexture::Level& entry = CookedTexture::GetLevel(*cooked, level);
+        glBindTexture(GL_TEXTURE_2D, id);
+        CookedTexture::SpecifyLevel((CookedTexture::Format)CookedTexture::GetHeader(*cooked).format, level, entry.width, entry.height, data, entry.size);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+
+        residentLevel = level;
+        bytes += entry.size;
+        streaming = false;
+    }
+
+    // drops the finest resident level, the texture id stays valid. GL thread only
+    void EvictFinestLevel()
+    {
+        if (!streamable || residentLevel >= minimumLevel)
+            return;
+
+        glBindTexture(GL_TEXTURE_2D, id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, residentLevel + 1);
+        CookedTexture::SpecifyLevel((CookedTexture::Format)CookedTexture::GetHeader(*cooked).format, residentLevel, 0, 0, nullptr, 0);
+
+        bytes -= LevelBytes(residentLevel);
+        residentLevel++;
+    }
+
+    ~CachedTexture()
+    {
+        if (id != 0)
+        {
+            MaterialLibrary::Forget(id);
+            glDeleteTextures(1, &id);
+        }
+        stbi_image_free(image.pixels);
+    }
+
+private:
+    friend class TextureCache;
+    ImageData image;
+    std::unique_ptr<MappedFile> cooked;    // set instead of image when a cooked file is used, released after upload unless streamable
+    std::once_flag decoded;
+};
+
+// Process wide texture cache keyed by a hash of the normalized path and the usage: the same file used as a color
+// map and as a normal map is two textures in different formats. Handles are ref-counted, the texture is deleted once the last model using it goes away.
+class TextureCache
+{
+public:
+    // decodes the file on the first request, safe from loader threads; later requests share the entry
+    static std::shared_ptr<CachedTexture> Acquire(const std::string& path, CookedTexture::Usage usage = CookedTexture::Usage::Color)
+    {
+        std::string normalized = Normalize(path);
+        uint64_t key = HashBytes(&usage, sizeof(usage), HashBytes(normalized.data(), normalized.size()));
+
+        std::shared_ptr<CachedTexture> texture;
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            Entry& entry = s_entries[key];
+            texture = entry.texture.lock();
+            if (!texture)
+            {
+                texture = std::shared_ptr<CachedTexture>(new CachedTexture(), [key](CachedTexture* released)
+                {
+                    std::lock_guard<std::mutex> lock(s_mutex);
+                    auto it = s_entries.find(key);
+                    if (it != s_entries.end() && it->second.texture.expired())
+                        s_entries.erase(it);
+                    delete released;
+                });
+                texture->path = normalized;
+                entry.texture = texture;
+                s_misses++;
+            }
+            else
+            {
+                s_hits++;
+            }
+        }
+
+        // decode outside the cache lock, a second thread asking for the same file waits here
+        std::call_once(texture->decoded, [&]() { Load(*texture, path, usage); });
+        return texture;
+    }
+
+    // references to every texture alive right now
+    static std::vector<std::shared_ptr<CachedTexture>> Resident()
+    {
+        std::vector<std::shared_ptr<CachedTexture>> resident;
+        std::lock_guard<std::mutex> lock(s_mutex);
+        for (auto& [key, entry] : s_entries)
+            if (std::shared_ptr<CachedTexture> texture = entry.texture.lock())
+                resident.push_back(texture);
+        return resident;
+    }
+
+    // prints the resident textures with their ref counts and size
+    static void Report()
+    {
+        // take references under the lock, print (and possibly release) them outside of it
+        std::vector<std::shared_ptr<CachedTexture>> resident = Resident();
+        size_t hits, misses;
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            hits = s_hits;
+            misses = s_misses;
+        }
+
+        size_t total = 0, totalSource = 0;
+        float loadMs = 0.0f, sourceMs = 0.0f;
+        std::cout << "\n[TextureCache] resident textures" << std::endl;
+        for (const std::shared_ptr<CachedTexture>& texture : resident)
+        {
+            // minus the reference held by this report
+            std::cout << "  " << texture->path << " | refs: " << texture.use_count() - 1 << " | " << texture->format << " "
+                << texture->bytes / 1024 << " KB (raw " << texture->sourceBytes / 1024 << " KB) | load " << texture->loadMs
+                << " ms (raw " << texture->sourceMs << " ms)" << std::endl;
+            total += texture->bytes;
+            totalSource += texture->sourceBytes;
+            loadMs += texture->loadMs;
+            sourceMs += texture->sourceMs;
+        }
+        std::cout << "[TextureCache] " << resident.size() << " textures, " << total / 1024 << " KB (raw " << totalSource / 1024 << " KB), "
+            << "load " << loadMs << " ms (raw decode " << sourceMs << " ms), " << hits << " hits / " << misses << " decodes" << std::endl;
+    }
+
+private:
+    struct Entry
+    {
+        std::weak_ptr<CachedTexture> texture;
+    };
+
+    // maps the cooked version of the file, cooking it first when missing; falls back to a plain decode
+    static void Load(CachedTexture& texture, const std::string& path, CookedTexture::Usage usage)
+    {
+        auto begin = std::chrono::high_resolution_clock::now();
+        auto elapsedMs = [&]() { return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - begin).count(); };
+
+        uint64_t hash = CookedTexture::s_enabled ? CookedTexture::SourceHash(path, usage) : 0;
+        if (hash != 0)
+        {
+            std::string cookedPath = CookedTexture::CookedPath(hash, usage);
+            texture.cooked = CookedTexture::Read(cookedPath, hash);
+            if (!texture.cooked)
+            {
+                if (CookedTexture::Cook(path, cookedPath, hash, usage))
+                    texture.cooked = CookedTexture::Read(cookedPath, hash);
+                else
+                    std::cout << "[TextureCache] failed to cook " << path << ", using the source" << std::endl;
+            }
+
+            if (texture.cooked)
+            {
+                const CookedTexture::Header* header = (const CookedTexture::Header*)texture.cooked->Data();
+                texture.format = CookedTexture::FormatName((CookedTexture::Format)header->format);
+                texture.sourceBytes = (size_t)header->sourceBytes;
+                texture.sourceMs = header->decodeMs;
+                texture.loadMs = elapsedMs();
+                return;
+            }
+        }
+
+        texture.image = DecodeImage(path);
+        texture.loadMs = texture.sourceMs = elapsedMs();
+    }
+
+    // lexically normal, forward slashes and lower case so "Texture\\A.png" and "./texture/a.png" match
+    static std::string Normalize(const std::string& path)
+    {
+        std::string normalized = path;
+        std::replace(normalized.begin(), normalized.end(), '\\', '/');
+        normalized = std::filesystem::path(normalized).lexically_normal().generic_string();
+        std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        return normalized;
+    }
+
+    inline static std::unordered_map<uint64_t, Entry> s_entries;
+    inline static std::mutex s_mutex;
+    inline static size_t s_hits = 0;
+    inline static size_t s_misses = 0;
+};
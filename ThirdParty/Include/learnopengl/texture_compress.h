@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// CPU side helpers for cooking textures: box filtered mip chains and BC1/BC3/BC5 block encoders.
+// Quality is aimed at "good enough for cooked game assets", the encoders fit endpoints along the
+// principal axis of each 4x4 block and pick the nearest palette entry per pixel.
+namespace TextureCompress
+{
+    // next mip level of an RGBA8 image, odd sizes clamp the last row/column
+    inline std::vector<unsigned char> Downsample(const std::vector<unsigned char>& src, int width, int height)
+    {
+        int w = std::max(width / 2, 1);
+        int h = std::max(height / 2, 1);
+        std::vector<unsigned char> dst((size_t)w * h * 4);
+
+        for (int y = 0; y < h; y++)
+        {
+            int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+            for (int x = 0; x < w; x++)
+            {
+                int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                for (int c = 0; c < 4; c++)
+                {
+                    int sum = src[((size_t)y0 * width + x0) * 4 + c] + src[((size_t)y0 * width + x1) * 4 + c]
+                        + src[((size_t)y1 * width + x0) * 4 + c] + src[((size_t)y1 * width + x1) * 4 + c];
+                    dst[((size_t)y * w + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        return dst;
+    }
+
+    // copies the 4x4 block at (bx, by) out of an RGBA8 image, edge pixels repeat for partial blocks
+    inline void FetchBlock(const unsigned char* image, int width, int height, int bx, int by, unsigned char block[16][4])
+    {
+        for (int y = 0; y < 4; y++)
+            for (int x = 0; x < 4; x++)
+            {
+                int sx = std::min(bx * 4 + x, width - 1);
+                int sy = std::min(by * 4 + y, height - 1);
+                memcpy(block[y * 4 + x], image + ((size_t)sy * width + sx) * 4, 4);
+            }
+    }
+
+    inline uint16_t To565(const float color[3])
+    {
+        int r = (int)std::lround(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f);
+        int g = (int)std::lround(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f);
+        int b = (int)std::lround(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f);
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    inline void From565(uint16_t c, int out[3])
+    {
+        int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        out[0] = (r << 3) | (r >> 2);
+        out[1] = (g << 2) | (g >> 4);
+        out[2] = (b << 3) | (b >> 2);
+    }
+
+    // 8 byte BC1 colour block, always in 4 colour mode (BC3 requires that too)
+    inline void EncodeColorBlock(const unsigned char block[16][4], unsigned char out[8])
+    {
+        float mean[3] = { 0, 0, 0 };
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 3; c++)
+                mean[c] += block[i][c] / 16.0f;
+
+        float cov[6] = { 0, 0, 0, 0, 0, 0 };
+        for (int i = 0; i < 16; i++)
+        {
+            float d[3] = { block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2] };
+            cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+            cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+        }
+
+        // principal axis by power iteration
+        float axis[3] = { 1, 1, 1 };
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[3] = {
+                cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2] };
+            float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+            if (length < 1e-6f)
+                break;
+            for (int c = 0; c < 3; c++)
+                axis[c] = next[c] / length;
+        }
+
+        float minProj = 1e30f, maxProj = -1e30f;
+        for (int i = 0; i < 16; i++)
+        {
+            float proj = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+            minProj = std::min(minProj, proj);
+            maxProj = std::max(maxProj, proj);
+        }
+
+        float maxColor[3], minColor[3];
+        for (int c = 0; c < 3; c++)
+        {
+            maxColor[c] = mean[c] + axis[c] * maxProj;
+            minColor[c] = mean[c] + axis[c] * minProj;
+        }
+
+        uint16_t c0 = To565(maxColor);
+        uint16_t c1 = To565(minColor);
+        if (c0 < c1)
+            std::swap(c0, c1);
+
+        uint32_t indices = 0;
+        if (c0 != c1)
+        {
+            int palette[4][3];
+            From565(c0, palette[0]);
+            From565(c1, palette[1]);
+            for (int c = 0; c < 3; c++)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0, bestError = 1 << 30;
+                for (int p = 0; p < 4; p++)
+                {
+                    int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+                    int error = dr * dr + dg * dg + db * db;
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+                indices |= (uint32_t)best << (i * 2);
+            }
+        }
+
+        out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+        out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+        memcpy(out + 4, &indices, 4);
+    }
+
+    // 8 byte BC4 block of one channel (BC3 alpha, BC5 red/green), 8 value interpolation mode
+    inline void EncodeChannelBlock(const unsigned char block[16][4], int channel, unsigned char out[8])
+    {
+        int a0 = 0, a1 = 255;
+        for (int i = 0; i < 16; i++)
+        {
+            a0 = std::max(a0, (int)block[i][channel]);
+            a1 = std::min(a1, (int)block[i][channel]);
+        }
+
+        out[0] = (unsigned char)a0;
+        out[1] = (unsigned char)a1;
+
+        uint64_t indices = 0;
+        if (a0 != a1)
+        {
+            int palette[8] = { a0, a1 };
+            for (int p = 1; p < 7; p++)
+                palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0, bestError = 1 << 30;
+                for (int p = 0; p < 8; p++)
+                {
+                    int error = std::abs(block[i][channel] - palette[p]);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+                indices |= (uint64_t)best << (i * 3);
+            }
+        }
+
+        for (int b = 0; b < 6; b++)
+            out[2 + b] = (unsigned char)(indices >> (b * 8));
+    }
+
+    enum class Format : uint32_t { RGBA8 = 0, BC1, BC3, BC5 };
+
+    inline size_t BlockBytes(Format format)
+    {
+        return format == Format::BC1 ? 8 : 16;
+    }
+
+    inline size_t LevelBytes(Format format, int width, int height)
+    {
+        if (format == Format::RGBA8)
+            return (size_t)width * height * 4;
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+    }
+
+    // encodes one RGBA8 level into the given block format
+    inline std::vector<unsigned char> Encode(const std::vector<unsigned char>& image, int width, int height, Format format)
+    {
+        if (format == Format::RGBA8)
+            return image;
+
+        int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        size_t blockBytes = BlockBytes(format);
+        std::vector<unsigned char> out((size_t)blocksX * blocksY * blockBytes);
+
+        unsigned char block[16][4];
+        for (int by = 0; by < blocksY; by++)
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                FetchBlock(image.data(), width, height, bx, by, block);
+                unsigned char* dst = &out[((size_t)by * blocksX + bx) * blockBytes];
+
+                if (format == Format::BC1)
+                    EncodeColorBlock(block, dst);
+                else if (format == Format::BC3)
+                {
+                    EncodeChannelBlock(block, 3, dst);
+                    EncodeColorBlock(block, dst + 8);
+                }
+                else
+                {
+                    EncodeChannelBlock(block, 0, dst);
+                    EncodeChannelBlock(block, 1, dst + 8);
+                }
+            }
+        return out;
+    }
+}
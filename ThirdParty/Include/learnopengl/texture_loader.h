@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <string>
+#include <iostream>
+
+// decoded pixels waiting for their GL upload
+struct ImageData
+{
+    unsigned char* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    std::string path;
+};
+
+// reads and decodes an image file, safe to call from any thread
+inline ImageData DecodeImage(const std::string& filename)
+{
+    ImageData image;
+    image.path = filename;
+    image.pixels = stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0);
+    if (!image.pixels)
+        std::cout << "Texture failed to load at path: " << filename << std::endl;
+    return image;
+}
+
+// creates the GL texture for a decoded image and frees the pixels, GL thread only
+inline unsigned int UploadImage(ImageData& image)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    if (image.pixels)
+    {
+        GLenum format = GL_RGB;
+        if (image.components == 1)
+            format = GL_RED;
+        else if (image.components == 3)
+            format = GL_RGB;
+        else if (image.components == 4)
+            format = GL_RGBA;
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        stbi_image_free(image.pixels);
+        image.pixels = nullptr;
+    }
+
+    return textureID;
+}